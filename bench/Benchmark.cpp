@@ -0,0 +1,255 @@
+/*==================================================================================
+* Headless benchmark
+*   Renders a fixed set of scenes without opening a window and reports frame
+*   times, ray throughput and BVH build time, as a table and optionally as JSON
+*   so runs can be compared across commits.
+*
+*   RayTracerBench [--scenes a,b,...] [--warmup N] [--reps N] [--json FILE]
+*                  [--heatmaps DIR] [--trace FILE] [render settings]
+*===================================================================================
+*/
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+#include "Scene.h"
+#include "Renderer.h"
+#include "TextureCache.h"
+#include "ImageWriter.h"
+#include "Profiler.h"
+#include "Config.h"
+using namespace std;
+
+#ifndef GIT_COMMIT
+#define GIT_COMMIT "unknown"
+#endif
+
+struct BenchScene {
+	string name;
+	bool runByDefault;
+};
+
+struct BenchResult {
+	string name;
+	size_t numObjects;
+	double bvhBuildMs;
+	double medianMs;
+	double p95Ms;
+	RayStats rays;
+};
+
+// Every named scene, the 1m object ones only when asked for
+static vector<BenchScene> benchScenes() {
+	vector<BenchScene> scenes;
+	for (const string& name : sceneNames()) {
+		bool large = name.size() > 3 && name.compare(name.size() - 3, 3, "_1m") == 0;
+		scenes.push_back({ name, !large });
+	}
+	return scenes;
+}
+
+static double percentile(vector<double> samples, double p) {
+	sort(samples.begin(), samples.end());
+	size_t i = (size_t)(p * (samples.size() - 1) + 0.5);
+	return samples[min(i, samples.size() - 1)];
+}
+
+static double elapsedMs(chrono::steady_clock::time_point start) {
+	return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+static BenchResult runScene(const BenchScene& bench, const RenderSettings& settings, int warmup, int reps,
+						   const string& heatmapDir) {
+	BenchResult result;
+	result.name = bench.name;
+
+	Scene scene;
+	TextureCache textureCache;
+	buildScene(bench.name, scene, textureCache);
+	result.numObjects = scene.objects.size();
+
+	auto start = chrono::steady_clock::now();
+	scene.build();
+	result.bvhBuildMs = elapsedMs(start);
+
+	Renderer renderer(&scene, settings);
+	for (int i = 0; i < warmup; i++) renderer.render();
+
+	vector<double> frameMs;
+	ProfileScope sceneScope(bench.name.c_str(), "scene");
+	for (int i = 0; i < reps; i++) {
+		start = chrono::steady_clock::now();
+		renderer.render();
+		frameMs.push_back(elapsedMs(start));
+	}
+	result.medianMs = percentile(frameMs, 0.5);
+	result.p95Ms = percentile(frameMs, 0.95);
+	result.rays = renderer.getStats();	//Every frame traces the same rays
+
+	if (!heatmapDir.empty()) {
+		string prefix = heatmapDir + "/" + bench.name;
+		writeBMP(prefix + ".bmp", renderer.getWidth(), renderer.getHeight(), renderer.getFramebuffer());
+		renderer.getHeatmaps().write(prefix);
+	}
+	return result;
+}
+
+static double mraysPerSec(uint64_t rays, double ms) {
+	return ms > 0.0 ? rays / (ms * 1000.0) : 0.0;
+}
+
+static void writeJson(ostream& out, const vector<BenchResult>& results, const RenderSettings& settings, int warmup, int reps) {
+	out << "{\n";
+	out << "  \"commit\": \"" << GIT_COMMIT << "\",\n";
+	out << "  \"width\": " << settings.width << ",\n";
+	out << "  \"height\": " << settings.height << ",\n";
+	out << "  \"max_depth\": " << settings.maxSteps << ",\n";
+	out << "  \"threads\": " << settings.numThreads << ",\n";
+	out << "  \"aa_samples\": " << (settings.enableAA ? settings.aaSamples : 1) << ",\n";
+	out << "  \"bvh\": " << (settings.enableBVH ? "true" : "false") << ",\n";
+#ifdef RAY_STATS
+	out << "  \"ray_stats\": true,\n";
+#else
+	out << "  \"ray_stats\": false,\n";	//Ray counts and throughput are all zero
+#endif
+	out << "  \"warmup\": " << warmup << ",\n";
+	out << "  \"reps\": " << reps << ",\n";
+	out << "  \"scenes\": [\n";
+	for (size_t i = 0; i < results.size(); i++) {
+		const BenchResult& r = results[i];
+		uint64_t total = r.rays.totalRays();
+		out << "    {\n";
+		out << "      \"name\": \"" << r.name << "\",\n";
+		out << "      \"objects\": " << r.numObjects << ",\n";
+		out << "      \"bvh_build_ms\": " << r.bvhBuildMs << ",\n";
+		out << "      \"frame_ms_median\": " << r.medianMs << ",\n";
+		out << "      \"frame_ms_p95\": " << r.p95Ms << ",\n";
+		out << "      \"rays\": { \"primary\": " << r.rays.primaryRays
+			<< ", \"shadow\": " << r.rays.shadowRays
+			<< ", \"secondary\": " << r.rays.secondaryRays << " },\n";
+		out << "      \"bvh_node_visits\": " << r.rays.nodeVisits << ",\n";
+		out << "      \"primitive_tests\": " << r.rays.primitiveTests << ",\n";
+		out << "      \"shadow_occlusion_rate\": " << r.rays.occlusionRate() << ",\n";
+		out << "      \"shading_points\": " << r.rays.shadingPoints << ",\n";
+		out << "      \"shadow_rays_per_point\": " << r.rays.shadowRaysPerPoint() << ",\n";
+		out << "      \"soft_shadows\": { \"tests\": " << r.rays.areaLightTests
+			<< ", \"probe_rays\": " << r.rays.probeShadowRays
+			<< ", \"penumbra_rays\": " << r.rays.penumbraShadowRays << " },\n";
+		out << "      \"bounce_depth\": [";
+		for (int d = 0; d < BOUNCE_DEPTH_BINS; d++) out << (d > 0 ? ", " : "") << r.rays.bounceDepth[d];
+		out << "],\n";
+		out << "      \"mrays_per_sec\": { \"primary\": " << mraysPerSec(r.rays.primaryRays, r.medianMs)
+			<< ", \"shadow\": " << mraysPerSec(r.rays.shadowRays, r.medianMs)
+			<< ", \"secondary\": " << mraysPerSec(r.rays.secondaryRays, r.medianMs)
+			<< ", \"total\": " << mraysPerSec(total, r.medianMs) << " }\n";
+		out << "    }" << (i + 1 < results.size() ? "," : "") << "\n";
+	}
+	out << "  ]\n";
+	out << "}\n";
+}
+
+static void printUsage() {
+	cout << "Usage: RayTracerBench [options]" << endl;
+	cout << "  --scenes a,b,...  scenes to run, or 'all' (default: all except the 1m scenes)" << endl;
+	cout << "  --warmup N        untimed frames before measuring (default 1)" << endl;
+	cout << "  --reps N          timed frames per scene (default 5)" << endl;
+	cout << "  --json FILE       also write the results as JSON to FILE ('-' for stdout)" << endl;
+	cout << "  --heatmaps DIR    write each scene's image and per-pixel cost heatmaps to DIR" << endl;
+	cout << "  --trace FILE      write a Chrome trace of every frame rendered to FILE" << endl;
+	cout << "Scenes:";
+	for (const BenchScene& s : benchScenes()) cout << " " << s.name;
+	cout << endl;
+	cout << "Defaults to a 400 x 400 image with anti-aliasing off and the BVH on." << endl;
+	printSettingsUsage();
+}
+
+int main(int argc, char *argv[]) {
+	RenderSettings settings;
+	settings.width = settings.height = 400;
+	settings.enableAA = false;
+	settings.enableBVH = true;
+	int warmup = 1;
+	int reps = 5;
+	string sceneList;
+	string jsonPath;
+	string heatmapDir;
+	string tracePath;
+
+	vector<string> args;
+	if (!parseSettings(argc, argv, settings, args)) return 1;
+	for (size_t i = 0; i < args.size(); i++) {
+		const string& arg = args[i];
+		bool hasValue = i + 1 < args.size();
+		if (arg == "--scenes" && hasValue) sceneList = args[++i];
+		else if (arg == "--warmup" && hasValue) warmup = atoi(args[++i].c_str());
+		else if (arg == "--reps" && hasValue) reps = atoi(args[++i].c_str());
+		else if (arg == "--json" && hasValue) jsonPath = args[++i];
+		else if (arg == "--heatmaps" && hasValue) heatmapDir = args[++i];
+		else if (arg == "--trace" && hasValue) tracePath = args[++i];
+		else {
+			printUsage();
+			return arg == "--help" ? 0 : 1;
+		}
+	}
+	if (reps < 1 || warmup < 0) {
+		cout << "Error :: --reps must be positive" << endl;
+		return 1;
+	}
+
+	// timing each pixel adds two clock reads per pixel to the frame times
+	settings.recordHeatmaps = !heatmapDir.empty();
+
+	vector<BenchScene> selected;
+	for (const BenchScene& s : benchScenes()) {
+		if (sceneList.empty() ? s.runByDefault : sceneList == "all") selected.push_back(s);
+	}
+	if (!sceneList.empty() && sceneList != "all") {
+		stringstream names(sceneList);
+		string name;
+		while (getline(names, name, ',')) {
+			vector<BenchScene> all = benchScenes();
+			auto it = find_if(all.begin(), all.end(), [&](const BenchScene& s) { return s.name == name; });
+			if (it == all.end()) {
+				cout << "Error :: Unknown scene '" << name << "'" << endl;
+				return 1;
+			}
+			selected.push_back(*it);
+		}
+	}
+
+	if (!tracePath.empty()) Profiler::start();
+
+	vector<BenchResult> results;
+	printf("%-16s %9s %10s %10s %10s %9s %9s %9s %9s\n", "scene", "objects", "bvh ms", "median ms", "p95 ms",
+		   "prim Mr/s", "shad Mr/s", "sec Mr/s", "shad/pt");
+	for (const BenchScene& s : selected) {
+		BenchResult r = runScene(s, settings, warmup, reps, heatmapDir);
+		printf("%-16s %9zu %10.2f %10.2f %10.2f %9.2f %9.2f %9.2f %9.2f\n", r.name.c_str(), r.numObjects, r.bvhBuildMs,
+			   r.medianMs, r.p95Ms, mraysPerSec(r.rays.primaryRays, r.medianMs),
+			   mraysPerSec(r.rays.shadowRays, r.medianMs), mraysPerSec(r.rays.secondaryRays, r.medianMs),
+			   r.rays.shadowRaysPerPoint());
+		fflush(stdout);
+		results.push_back(r);
+	}
+
+	if (!tracePath.empty()) Profiler::stop(tracePath);
+
+	if (jsonPath == "-") {
+		writeJson(cout, results, settings, warmup, reps);
+	} else if (!jsonPath.empty()) {
+		ofstream out(jsonPath);
+		if (!out) {
+			cout << "Error :: Unable to open " << jsonPath << endl;
+			return 1;
+		}
+		writeJson(out, results, settings, warmup, reps);
+	}
+	return 0;
+}
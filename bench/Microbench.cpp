@@ -0,0 +1,296 @@
+/*==================================================================================
+* Kernel microbenchmarks
+*   Times the primitive intersection kernels and BVH traversal on their own by
+*   feeding them pre-generated rays, either coherent (a pinhole camera grid) or
+*   random (random origins and directions). Reports ns/ray and millions of
+*   intersection tests per second, and cross-checks BVH traversal against a
+*   linear scan over the same objects.
+*
+*   RayTracerMicrobench [--rays N] [--bvh-rays N] [--reps N] [--check-rays N] [--json FILE]
+*===================================================================================
+*/
+
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <functional>
+#include <glm/glm.hpp>
+#include "Scene.h"
+#include "Ray.h"
+#include "Random.h"
+#include "Sphere.h"
+#include "SphereBatch.h"
+#include "Plane.h"
+#include "Cylinder.h"
+#include "Cone.h"
+#include "AABB.h"
+using namespace std;
+
+#ifndef GIT_COMMIT
+#define GIT_COMMIT "unknown"
+#endif
+
+struct RaySet {
+	string name;
+	vector<glm::vec3> origins;
+	vector<glm::vec3> dirs;
+	size_t size() const { return dirs.size(); }
+};
+
+struct KernelResult {
+	string kernel;
+	string rays;
+	size_t numRays;
+	double nsPerRay;
+	double testsPerRay;		//Intersection tests per ray, more than one for BVH traversal
+	double hitRate;
+};
+
+// Primary rays through a numDiv x numDiv grid over the default view window
+static RaySet coherentRays(size_t numRays) {
+	RaySet set;
+	set.name = "coherent";
+	int numDiv = max(1, (int)sqrt((double)numRays));
+	float cell = 20.0f / numDiv;
+	for (int j = 0; j < numDiv; j++) {
+		for (int i = 0; i < numDiv; i++) {
+			set.origins.push_back(glm::vec3(0));
+			set.dirs.push_back(glm::normalize(glm::vec3(-10 + (i + 0.5f) * cell, -10 + (j + 0.5f) * cell, -25.0f)));
+		}
+	}
+	return set;
+}
+
+// Origins scattered around the scene, directions uniform over the sphere
+static RaySet randomRays(size_t numRays) {
+	RaySet set;
+	set.name = "random";
+	Random rng(numRays);
+	for (size_t i = 0; i < numRays; i++) {
+		glm::vec3 origin(rng.nextFloat() * 40 - 20, rng.nextFloat() * 40 - 20, rng.nextFloat() * -100);
+		float z = 1 - 2 * rng.nextFloat();
+		float r = sqrt(max(0.0f, 1 - z * z));
+		float phi = 2 * M_PI * rng.nextFloat();
+		set.origins.push_back(origin);
+		set.dirs.push_back(glm::vec3(r * cos(phi), r * sin(phi), z));
+	}
+	return set;
+}
+
+// Every stride'th ray of rays, so a subset still covers the whole distribution
+static RaySet subset(const RaySet& rays, size_t numRays) {
+	RaySet set;
+	set.name = rays.name;
+	size_t stride = max<size_t>(1, rays.size() / max<size_t>(1, numRays));
+	for (size_t i = 0; i < rays.size(); i += stride) {
+		set.origins.push_back(rays.origins[i]);
+		set.dirs.push_back(rays.dirs[i]);
+	}
+	return set;
+}
+
+static double elapsedNs(chrono::steady_clock::time_point start) {
+	return chrono::duration<double, nano>(chrono::steady_clock::now() - start).count();
+}
+
+/*
+ * Runs kernel over every ray reps times and keeps the fastest pass.
+ * kernel returns the hit distance (<= 0 on a miss) and adds its tests to tests.
+ */
+static KernelResult timeKernel(const string& name, const RaySet& rays, int reps,
+							   const function<float(const glm::vec3&, const glm::vec3&, uint64_t&)>& kernel) {
+	double best = 1e300;
+	uint64_t tests = 0, hits = 0;
+	volatile float sink = 0;
+	for (int r = 0; r < reps; r++) {
+		tests = hits = 0;
+		float sum = 0;
+		auto start = chrono::steady_clock::now();
+		for (size_t i = 0; i < rays.size(); i++) {
+			float t = kernel(rays.origins[i], rays.dirs[i], tests);
+			if (t > 0) {
+				sum += t;
+				hits++;
+			}
+		}
+		best = min(best, elapsedNs(start));
+		sink = sink + sum;
+	}
+	KernelResult result;
+	result.kernel = name;
+	result.rays = rays.name;
+	result.numRays = rays.size();
+	result.nsPerRay = best / rays.size();
+	result.testsPerRay = (double)tests / rays.size();
+	result.hitRate = (double)hits / rays.size();
+	return result;
+}
+
+/*
+ * Compares the closest hit found by BVH traversal with a linear scan over the
+ * same objects. Returns the number of rays where they disagree.
+ */
+static size_t crossCheck(const string& name, Scene& scene, const RaySet& rays) {
+	size_t mismatches = 0;
+	for (size_t i = 0; i < rays.size(); i++) {
+		Ray linear, bvh;
+		linear.p0 = bvh.p0 = rays.origins[i];
+		linear.dir = bvh.dir = rays.dirs[i];
+		linear.closestPt(scene.objects);
+		bvh.closestPt(*scene.bvh);
+		const RayHit &l = linear.hit, &b = bvh.hit;
+		bool agree = (l.primID == b.primID) || (l.isHit() && b.isHit() && fabs(l.t - b.t) <= 1e-4f * l.t);
+		if (!agree) {
+			if (mismatches < 5) {
+				printf("  mismatch %s ray %zu: linear obj %d t=%g, bvh obj %d t=%g\n", name.c_str(), i,
+					   l.primID, l.t, b.primID, b.t);
+			}
+			mismatches++;
+		}
+	}
+	printf("cross-check %-12s %-8s %zu rays, %zu mismatches\n", name.c_str(), rays.name.c_str(), rays.size(), mismatches);
+	return mismatches;
+}
+
+static void writeJson(ostream& out, const vector<KernelResult>& results, size_t mismatches) {
+	out << "{\n";
+	out << "  \"commit\": \"" << GIT_COMMIT << "\",\n";
+	out << "  \"bvh_mismatches\": " << mismatches << ",\n";
+	out << "  \"kernels\": [\n";
+	for (size_t i = 0; i < results.size(); i++) {
+		const KernelResult& r = results[i];
+		out << "    { \"kernel\": \"" << r.kernel << "\", \"rays\": \"" << r.rays << "\", \"num_rays\": " << r.numRays
+			<< ", \"ns_per_ray\": " << r.nsPerRay << ", \"tests_per_ray\": " << r.testsPerRay
+			<< ", \"mtests_per_sec\": " << r.testsPerRay * 1000.0 / r.nsPerRay
+			<< ", \"hit_rate\": " << r.hitRate << " }" << (i + 1 < results.size() ? "," : "") << "\n";
+	}
+	out << "  ]\n";
+	out << "}\n";
+}
+
+int main(int argc, char *argv[]) {
+	size_t numRays = 1000000;
+	size_t numBVHRays = 50000;		//Traversal is orders of magnitude slower than a single test
+	size_t numCheckRays = 20000;
+	int reps = 3;
+	string jsonPath;
+
+	for (int i = 1; i < argc; i++) {
+		string arg = argv[i];
+		bool hasValue = i + 1 < argc;
+		if (arg == "--rays" && hasValue) numRays = atol(argv[++i]);
+		else if (arg == "--bvh-rays" && hasValue) numBVHRays = atol(argv[++i]);
+		else if (arg == "--check-rays" && hasValue) numCheckRays = atol(argv[++i]);
+		else if (arg == "--reps" && hasValue) reps = atoi(argv[++i]);
+		else if (arg == "--json" && hasValue) jsonPath = argv[++i];
+		else {
+			cout << "Usage: RayTracerMicrobench [--rays N] [--bvh-rays N] [--reps N] [--check-rays N] [--json FILE]" << endl;
+			return arg == "--help" ? 0 : 1;
+		}
+	}
+	if (numRays < 1 || reps < 1) {
+		cout << "Error :: --rays and --reps must be positive" << endl;
+		return 1;
+	}
+
+	vector<RaySet> raySets = { coherentRays(numRays), randomRays(numRays) };
+
+	Sphere sphere(glm::vec3(0, 0, -60), 10.0);
+	Plane quad(glm::vec3(-20, -20, -60), glm::vec3(20, -20, -60), glm::vec3(20, 20, -60), glm::vec3(-20, 20, -60));
+	Plane triangle(glm::vec3(-20, -20, -60), glm::vec3(20, -20, -60), glm::vec3(0, 20, -60));
+	Cylinder cylinder(glm::vec3(0, -10, -60), 8, 20);
+	Cone cone(glm::vec3(0, -10, -60), 8, 20);
+	AABB box(glm::vec3(-10, -10, -70), glm::vec3(10, 10, -50));
+	// A ring of eight spheres the size of the one above, tested as a batch
+	vector<Sphere> ring;
+	SphereBatch ringBatch;
+	for (int i = 0; i < SPHERE_BATCH_WIDTH; i++) {
+		float angle = 2 * M_PI * i / SPHERE_BATCH_WIDTH;
+		ring.push_back(Sphere(glm::vec3(20 * cos(angle), 20 * sin(angle), -60), 10.0));
+	}
+	for (int i = 0; i < SPHERE_BATCH_WIDTH; i++) ringBatch.add(ring[i], i);
+
+	// The cloud scenes used for BVH traversal, 100k objects for timing and 1k for the cross-check
+	Scene cloud, smallCloud, smallMesh;
+	srand(1);
+	drawCircles(cloud, 100000, true);
+	cloud.build();
+	drawCircles(smallCloud, 1000, true);
+	smallCloud.build();
+	buildMesh(smallMesh, 2000);
+	smallMesh.build();
+
+	vector<KernelResult> results;
+	for (const RaySet& rays : raySets) {
+		results.push_back(timeKernel("sphere", rays, reps, [&](const glm::vec3& p0, const glm::vec3& dir, uint64_t& tests) {
+			tests++;
+			return sphere.intersect(p0, dir);
+		}));
+		results.push_back(timeKernel("sphere8", rays, reps, [&](const glm::vec3& p0, const glm::vec3& dir, uint64_t& tests) {
+			tests += SPHERE_BATCH_WIDTH;
+			float t = -1;
+			ringBatch.intersect(p0, dir, 0, 1.e+6, t);
+			return t;
+		}));
+		results.push_back(timeKernel("quad", rays, reps, [&](const glm::vec3& p0, const glm::vec3& dir, uint64_t& tests) {
+			tests++;
+			return quad.intersect(p0, dir);
+		}));
+		results.push_back(timeKernel("triangle", rays, reps, [&](const glm::vec3& p0, const glm::vec3& dir, uint64_t& tests) {
+			tests++;
+			return triangle.intersect(p0, dir);
+		}));
+		// isInside on the points where the rays cross the plane of the quad, inside or not
+		results.push_back(timeKernel("quad_inside", rays, reps, [&](const glm::vec3& p0, const glm::vec3& dir, uint64_t& tests) {
+			tests++;
+			glm::vec3 pt = p0 + dir * ((-60 - p0.z) / dir.z);
+			return quad.isInside(pt) ? 1.0f : -1.0f;
+		}));
+		results.push_back(timeKernel("cylinder", rays, reps, [&](const glm::vec3& p0, const glm::vec3& dir, uint64_t& tests) {
+			tests++;
+			return cylinder.intersect(p0, dir);
+		}));
+		results.push_back(timeKernel("cone", rays, reps, [&](const glm::vec3& p0, const glm::vec3& dir, uint64_t& tests) {
+			tests++;
+			return cone.intersect(p0, dir);
+		}));
+		results.push_back(timeKernel("aabb", rays, reps, [&](const glm::vec3& p0, const glm::vec3& dir, uint64_t& tests) {
+			tests++;
+			return box.intersect(p0, dir);
+		}));
+		results.push_back(timeKernel("bvh_100k", subset(rays, numBVHRays), reps, [&](const glm::vec3& p0, const glm::vec3& dir, uint64_t& tests) {
+			Ray ray(p0, dir);
+			int nodeVisits = 0;
+			tests += cloud.bvh->intersect(ray, &nodeVisits) + nodeVisits;
+			return ray.hit.t;
+		}));
+	}
+
+	printf("%-12s %-8s %9s %9s %11s %8s\n", "kernel", "rays", "ns/ray", "tests/ray", "Mtests/s", "hit rate");
+	for (const KernelResult& r : results) {
+		printf("%-12s %-8s %9.2f %9.2f %11.2f %8.3f\n", r.kernel.c_str(), r.rays.c_str(), r.nsPerRay, r.testsPerRay,
+			   r.testsPerRay * 1000.0 / r.nsPerRay, r.hitRate);
+	}
+
+	size_t mismatches = 0;
+	for (RaySet rays : { coherentRays(numCheckRays), randomRays(numCheckRays) }) {
+		mismatches += crossCheck("spheres_1k", smallCloud, rays);
+		mismatches += crossCheck("mesh_2k", smallMesh, rays);
+	}
+
+	if (!jsonPath.empty()) {
+		ofstream out(jsonPath);
+		if (!out) {
+			cout << "Error :: Unable to open " << jsonPath << endl;
+			return 1;
+		}
+		writeJson(out, results, mismatches);
+	}
+	return mismatches == 0 ? 0 : 2;
+}
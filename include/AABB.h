@@ -7,7 +7,10 @@ class AABB {
     public:
         AABB() : min(glm::vec3(0)), max(glm::vec3(0)) {}
         AABB(glm::vec3 min, glm::vec3 max) : min(min), max(max) {}
-        float intersect(glm::vec3 p0, glm::vec3 dir);
+        float intersect(const glm::vec3& p0, const glm::vec3& dir);
+        float entryDistance(const glm::vec3& p0, const glm::vec3& dir);
+        // The interval of the ray inside the box, false if it misses or the box is behind it
+        bool interval(const glm::vec3& p0, const glm::vec3& dir, float& tNear, float& tFar) const;
         void setAABB(glm::vec3 min, glm::vec3 max) { this->min = min; this->max = max; }
         glm::vec3 getMin() const { return min; }
         glm::vec3 getMax() const { return max; }
@@ -0,0 +1,27 @@
+#ifndef ANIMATION_H
+#define ANIMATION_H
+
+#include <string>
+#include "Renderer.h"
+
+struct AnimationSettings {
+    int firstFrame = 0;
+    int lastFrame = 0;                              // inclusive
+    float fps = 24.0f;
+    std::string outputPattern = "frame_%04d.bmp";   // printf pattern given the frame number
+};
+
+/*
+ * Renders a range of frames of a named scene, posing it with Scene::update()
+ * at each frame's time, and writes each frame as a BMP.
+ *
+ * Frames overlap instead of ending in a barrier: the scene is built twice,
+ * and while one copy is traced the other is posed for the next frame and its
+ * tiles queued behind the current frame's, so the tracing threads move
+ * straight on to it. When a frame finishes, its image is written and its
+ * copy of the scene posed for the frame after next while the threads trace
+ * the one in between. Scene::update() refits the BVH rather than rebuilding it.
+ */
+bool renderAnimation(const std::string& sceneName, const RenderSettings& settings, const AnimationSettings& animation);
+
+#endif
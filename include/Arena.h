@@ -0,0 +1,53 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <new>
+#include <vector>
+#include <cstddef>
+#include <utility>
+#include <type_traits>
+
+/*
+ * Bump-pointer allocator for objects that all live exactly as long as the
+ * arena, like a scene's objects or a BVH's nodes. Objects are placed one after
+ * another in large blocks, so objects created in sequence sit in sequence in
+ * memory, and reset() destroys every one of them and frees the blocks in one
+ * go instead of an allocator call per object.
+ */
+class Arena {
+    public:
+        explicit Arena(size_t blockSize = 256 * 1024) : blockSize(blockSize) {}
+        ~Arena() { reset(); }
+        Arena(const Arena&) = delete;
+        Arena& operator=(const Arena&) = delete;
+
+        // Constructs a T in the arena; it is destroyed by reset() or the arena's destructor
+        template <typename T, typename... Args>
+        T* create(Args&&... args) {
+            T* object = new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+            if (!std::is_trivially_destructible<T>::value) {
+                destructors.push_back({ [](void* p) { static_cast<T*>(p)->~T(); }, object });
+            }
+            return object;
+        }
+
+        void* allocate(size_t size, size_t alignment);
+        // Destroys every object in reverse order of creation and frees all the memory
+        void reset();
+        void swap(Arena& other);
+        size_t bytesUsed() const { return used; }
+    private:
+        struct Destructor {
+            void (*destroy)(void*);
+            void* object;
+        };
+
+        size_t blockSize;
+        std::vector<char*> blocks;
+        char* cursor = nullptr;
+        char* end = nullptr;
+        size_t used = 0;
+        std::vector<Destructor> destructors;
+};
+
+#endif
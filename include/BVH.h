@@ -4,30 +4,35 @@
 #include <vector>
 #include "SceneObject.h"
 #include "BVHNode.h"
+#include "Ray.h"
+#include "SphereBatch.h"
+#include "Arena.h"
 
 #define LEAF_OBJ_THRESHOLD 2
 
-struct RayHit{
-    int objIdx = -1;
-    float dist = -1.0f;
-    glm::vec3 hit; 
-    int numIntersections;
-};
-
 class BVH {
     public:
         BVH(std::vector<SceneObject*> *sceneObjects);
-        struct RayHit intersect(glm::vec3 p0, glm::vec3 dir);
+        BVH(const BVH&) = delete;
+        BVH& operator=(const BVH&) = delete;
+        // Finds the closest hit into ray.hit, returns the objects tested and the bounding boxes tested in nodeVisits
+        int intersect(Ray& ray, int *nodeVisits = nullptr);
+        // Recomputes every node's bounding box after objects move, keeping the tree as it was built
+        void refit();
 
         void printNodes();
         // void printGraph();
     private:
         void buildRecursive(BVHNode *node);
+        bool makeSphereBatch(BVHNode *node);
+        AABB refitNode(BVHNode *node);
         AABB unionAABB(const AABB& a, const AABB& b);
         void printNode(BVHNode *node, unsigned int &index);
         
         std::vector<SceneObject*> *sceneObjects;
+        Arena nodes;        // owns every node, freed with the tree
         BVHNode *head;
+        std::vector<SphereBatch> sphereBatches;
 };
 
 #endif
\ No newline at end of file
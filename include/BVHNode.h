@@ -6,8 +6,8 @@
 
 class BVHNode {
     public:
-        BVHNode() : leaf(false), index(0), numObjects(0) {}
-        BVHNode(unsigned int index, unsigned int numObjects) : leaf(false), index(index), numObjects(numObjects) {}
+        BVHNode() : leaf(false), numObjects(0), index(0) {}
+        BVHNode(unsigned int index, unsigned int numObjects) : leaf(false), numObjects(numObjects), index(index) {}
         void setAABB(const AABB& bbox) { this->bbox = bbox; }
         void setIndex(unsigned int index) { this->index = index; }
         void setNumObjects(unsigned int numObjects) { this->numObjects = numObjects; }
@@ -16,6 +16,8 @@ class BVHNode {
         unsigned int getIndex() { return index; }
         AABB getBBox() { return bbox; }
         bool isLeaf() { return leaf; }
+        int getBatch() { return batch; }
+        void setBatch(int batch) { this->batch = batch; }
         BVHNode* getLeft() { return left; }
         BVHNode* getRight() { return right; }
         void setLeft(BVHNode* left) { this->left = left; }
@@ -25,9 +27,10 @@ class BVHNode {
         bool leaf;
         unsigned int numObjects;
         unsigned int index;
+        int batch = -1;     // the leaf's SphereBatch in the BVH, when it holds only spheres
 
-        BVHNode *left;
-        BVHNode *right;
+        BVHNode *left = nullptr;
+        BVHNode *right = nullptr;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,64 @@
+#ifndef CAMERA_H
+#define CAMERA_H
+
+#include <vector>
+#include <glm/glm.hpp>
+#include "Ray.h"
+#include "RayDifferential.h"
+
+/*
+ * A pinhole or thin-lens camera. Generates the primary ray through any point
+ * of an image of width x height square cells. The default camera sits at the
+ * origin looking down -z with the view the ray tracer has always had: a window
+ * 20 units high, 25 units in front of the eye.
+ */
+class Camera {
+    public:
+        void lookAt(glm::vec3 eye, glm::vec3 target, glm::vec3 up = glm::vec3(0, 1, 0));
+        void setFov(float degrees);     // vertical field of view
+        void setAperture(float radius) { aperture = radius; }   // lens radius, 0 for a pinhole
+        void setFocusDistance(float distance) { focusDistance = distance; }
+        void setResolution(int width, int height);
+
+        // x and y are in cells from the bottom left of the image, lensU and lensV
+        // in [0, 1) pick the point on the lens. diff is set to the ray's differentials
+        Ray generateRay(float x, float y, float lensU, float lensV, RayDifferential& diff) const;
+
+        bool hasDepthOfField() const { return aperture > 0.0f; }
+        glm::vec3 getEye() const { return eye; }
+        glm::vec3 getForward() const { return forward; }
+        float getFov() const;
+        float getAperture() const { return aperture; }
+        float getFocusDistance() const { return focusDistance; }
+    private:
+        glm::vec3 eye = glm::vec3(0);
+        glm::vec3 forward = glm::vec3(0, 0, -1);
+        glm::vec3 right = glm::vec3(1, 0, 0);
+        glm::vec3 up = glm::vec3(0, 1, 0);
+        float tanHalfFov = 10.0f / 25.0f;   // half the window's height, one unit in front of the eye
+        float aperture = 0.0f;              // lens radius, 0 for a pinhole
+        float focusDistance = 25.0f;        // distance along forward to the plane in focus
+        int width = 1;
+        int height = 1;
+};
+
+/*
+ * A camera move: eye and target positions keyed by time in seconds, joined
+ * by a Catmull-Rom spline through the keys. Before the first key and after
+ * the last the camera holds still.
+ */
+class CameraPath {
+    public:
+        void addKey(float time, glm::vec3 eye, glm::vec3 target);   // in increasing time
+        bool empty() const { return keys.empty(); }
+        void apply(Camera& camera, float time) const;
+    private:
+        struct Key {
+            float time;
+            glm::vec3 eye;
+            glm::vec3 target;
+        };
+        std::vector<Key> keys;
+};
+
+#endif
@@ -0,0 +1,77 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include "Renderer.h"
+
+/*
+ * The state of a progressive render: the sum of every sample traced through
+ * each cell, how many there were, and the state of each cell's random number
+ * generator after its last sample. Each pass of Renderer::renderPass() adds
+ * one sample per cell, so a render resumed from this state carries on exactly
+ * as if it had never stopped.
+ */
+struct Accumulation {
+    int width = 0;
+    int height = 0;
+    int passes = 0;                     // passes completed
+    std::vector<glm::vec3> sum;
+    std::vector<uint32_t> samples;
+    std::vector<uint64_t> rngState;
+
+    void reset(int width, int height);  // no samples, each cell's generator seeded from its index
+    glm::vec3 mean(size_t cell) const { return samples[cell] > 0 ? sum[cell] / (float)samples[cell] : glm::vec3(0); }
+};
+
+/*
+ * Checkpoints hold the accumulation and a description of the job that made
+ * it (scene and settings), so a resume can refuse a checkpoint from another
+ * job. They are written to a temporary file and renamed over the last one,
+ * so a render killed mid-write still has its previous checkpoint.
+ */
+bool writeCheckpoint(const std::string& path, const std::string& job, const Accumulation& accumulation);
+bool readCheckpoint(const std::string& path, std::string& job, Accumulation& accumulation);
+
+// Writes checkpoints on a thread of their own, from a copy taken when write() is called
+class CheckpointWriter {
+    public:
+        CheckpointWriter() = default;
+        ~CheckpointWriter() { finish(); }
+        CheckpointWriter(const CheckpointWriter&) = delete;
+        CheckpointWriter& operator=(const CheckpointWriter&) = delete;
+
+        // Returns false without copying anything if the last checkpoint is still being written
+        bool write(const std::string& path, const std::string& job, const Accumulation& accumulation);
+        // Waits for the checkpoint being written, returns false if any write failed
+        bool finish();
+    private:
+        std::thread thread;
+        std::atomic<bool> busy { false };
+        std::atomic<bool> failed { false };
+        Accumulation snapshot;
+};
+
+struct ProgressiveSettings {
+    int passes = 64;                    // samples per cell when the render is finished
+    std::string checkpointPath;         // no checkpoints when empty
+    float checkpointInterval = 60.0f;   // seconds between checkpoints
+    bool resume = false;                // carry on from checkpointPath
+};
+
+/*
+ * Renders a named scene progressively, one jittered sample per cell per
+ * pass, checkpointing every checkpointInterval seconds. SIGINT or SIGTERM
+ * stops it after the pass being traced, with a final checkpoint. Returns
+ * false on failure or when stopped early; image holds the mean of the
+ * samples traced either way.
+ */
+bool renderProgressive(const std::string& sceneName, const RenderSettings& settings,
+                       const ProgressiveSettings& progressive, std::vector<glm::vec3>& image);
+
+#endif
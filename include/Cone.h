@@ -4,20 +4,36 @@
 #include "SceneObject.h"
 #include <glm/glm.hpp>
 
+/*
+ * A capped cone with its apex at center and its base height below it, along
+ * axis (up by default, from the base to the apex). Like Cylinder it works on
+ * the ray's components along the axis, so it can be tilted for free.
+ */
 class Cone : virtual public SceneObject {
 private:
     glm::vec3 center;
     float radius;
     float height;
+    glm::vec3 axis = glm::vec3(0, 1, 0);   // unit
+
+    // set by precompute()
+    float radiusSq;
+    float slopeSq;                          // (radius / height)^2, the squared tangent of the half angle
+    float cosHalfAngle;
+    void precompute();
 protected:
     void calculateAABB() override;
 public:
-    Cone() : center(glm::vec3(0)), radius(1), height(1) { calculateAABB(); };
-    Cone(glm::vec3 c, float r, float h) : center(c), radius(r), height(h) { calculateAABB(); };
+    Cone() : center(glm::vec3(0)), radius(1), height(1) { precompute(); calculateAABB(); };
+    Cone(glm::vec3 c, float r, float h) : center(c), radius(r), height(h) { precompute(); calculateAABB(); };
+    Cone(glm::vec3 c, float r, float h, glm::vec3 axis) :
+        center(c), radius(r), height(h), axis(glm::normalize(axis)) { precompute(); calculateAABB(); };
 
-    float intersect(glm::vec3 p0, glm::vec3 dir) override;
-    glm::vec3 normal(glm::vec3 p) override;
+    float intersect(const glm::vec3& p0, const glm::vec3& dir) override;
+    glm::vec3 normal(const glm::vec3& p) override;
+    void translate(glm::vec3 offset) override { center += offset; calculateAABB(); }
+    SceneObject* clone(Arena& arena) const override { return arena.create<Cone>(*this); }
     
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,27 @@
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#include <string>
+#include <vector>
+#include <iostream>
+#include "Renderer.h"
+
+/*
+ * Runtime configuration of RenderSettings, shared by the viewer and the
+ * benchmarks. Settings are named the same on the command line (--name value)
+ * and in a config file (name = value, one per line, # starts a comment).
+ */
+
+// Sets one setting by name, returns false if the name or value is invalid
+bool applySetting(const std::string& name, const std::string& value, RenderSettings& settings);
+bool loadConfigFile(const std::string& path, RenderSettings& settings);
+// Applies config lines read from in, source names it in error messages
+bool parseConfig(std::istream& in, const std::string& source, RenderSettings& settings);
+// Writes every setting as config lines that parseConfig() reads back
+void writeSettings(std::ostream& out, const RenderSettings& settings);
+
+// Applies the settings flags in argv, in order, and leaves any others in unparsed
+bool parseSettings(int argc, char *argv[], RenderSettings& settings, std::vector<std::string>& unparsed);
+void printSettingsUsage();
+
+#endif
@@ -4,20 +4,31 @@
 #include "SceneObject.h"
 #include <glm/glm.hpp>
 
+/*
+ * A capped cylinder standing on the disc at center, extending height along
+ * axis (up by default). Intersection works on the ray's components along the
+ * axis, so a tilted cylinder costs no more than an upright one.
+ */
 class Cylinder : virtual public SceneObject {
 private:
     glm::vec3 center;
     float radius;
     float height;
+    glm::vec3 axis = glm::vec3(0, 1, 0);   // unit
+    float radiusSq;
 protected:
     void calculateAABB() override;
 public:
-    Cylinder() : center(glm::vec3(0)), radius(1), height(1) { calculateAABB(); };
-    Cylinder(glm::vec3 c, float r, float h) : center(c), radius(r), height(h) { calculateAABB(); };
+    Cylinder() : center(glm::vec3(0)), radius(1), height(1), radiusSq(1) { calculateAABB(); };
+    Cylinder(glm::vec3 c, float r, float h) : center(c), radius(r), height(h), radiusSq(r * r) { calculateAABB(); };
+    Cylinder(glm::vec3 c, float r, float h, glm::vec3 axis) :
+        center(c), radius(r), height(h), axis(glm::normalize(axis)), radiusSq(r * r) { calculateAABB(); };
 
-    float intersect(glm::vec3 p0, glm::vec3 dir) override;
-    glm::vec3 normal(glm::vec3 p) override;
+    float intersect(const glm::vec3& p0, const glm::vec3& dir) override;
+    glm::vec3 normal(const glm::vec3& p) override;
+    void translate(glm::vec3 offset) override { center += offset; calculateAABB(); }
+    SceneObject* clone(Arena& arena) const override { return arena.create<Cylinder>(*this); }
     
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,94 @@
+#ifndef DENOISER_H
+#define DENOISER_H
+
+#include <vector>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+const float NO_HIT_DEPTH = 1.e+6;   //Depth of cells whose rays miss everything, the farthest a ray reaches
+
+// What a camera ray's first hit looks like, for guiding the denoiser
+struct AuxSample {
+    glm::vec3 albedo = glm::vec3(0);    //Surface colour before lighting
+    glm::vec3 normal = glm::vec3(0);    //Unit normal facing the ray, zero on a miss
+    float depth = NO_HIT_DEPTH;         //Distance along the ray
+};
+
+/*
+ * The albedo, normal and depth of the first surface the camera rays of each
+ * cell hit, averaged over the cell's samples. Row-major from the bottom left,
+ * like the framebuffer.
+ */
+struct AuxBuffers {
+    int width = 0;
+    int height = 0;
+    std::vector<glm::vec3> albedo;
+    std::vector<glm::vec3> normal;
+    std::vector<float> depth;
+    std::vector<uint32_t> samples;  //Samples averaged into each cell
+
+    void resize(int width, int height);
+    void clear(size_t cell) { samples[cell] = 0; }
+    void add(size_t cell, const AuxSample& sample);
+};
+
+/*
+ * Edge-avoiding à-trous wavelet filter (Dammertz et al. 2010) for renders of
+ * a few samples per cell. Colour is divided by albedo first so textures are
+ * kept sharp and only the lighting is smoothed, then a 5 x 5 B3-spline kernel
+ * is applied DENOISE_ITERATIONS times with its taps spread twice as far each
+ * time. Each tap is weighted down by how far its normal, depth and lighting
+ * are from the centre's, so edges of objects, creases and shadows stay put
+ * while noise within a surface is averaged out.
+ *
+ * The image is filtered as separate planes of floats, and each tap is applied
+ * to a whole row at a time without branches, so the compiler vectorises the
+ * inner loops. Bands of rows are shared between numThreads threads.
+ */
+const int DENOISE_ITERATIONS = 5;
+const int DENOISE_BAND = 16;        //Rows a thread filters at a time
+
+void denoise(const std::vector<glm::vec3>& color, const AuxBuffers& aux, int numThreads, std::vector<glm::vec3>& out);
+
+/*
+ * denoise() in steps, for callers running their own threads. The filter
+ * makes 1 + DENOISE_ITERATIONS passes over the image, each split into bands
+ * that can be filtered in any order and at once; once every band of a pass
+ * is filtered, nextPass() starts the next. aux must outlive the denoiser.
+ */
+class Denoiser {
+    public:
+        Denoiser(const std::vector<glm::vec3>& color, const AuxBuffers& aux);
+
+        int getNumBands() const { return (guide.height + DENOISE_BAND - 1) / DENOISE_BAND; }
+        // scratch is the calling thread's own, kept between calls so it is only allocated once
+        void filterBand(int band, std::vector<float>& scratch);
+        // Returns false once the last pass is done
+        bool nextPass();
+        void getImage(std::vector<glm::vec3>& out) const;
+    private:
+        // One float per cell for each channel, so rows of a channel are contiguous
+        struct Planes {
+            std::vector<float> r, g, b;
+        };
+
+        // What the filter's weights compare, split into planes like the colour
+        struct Guide {
+            int width, height;
+            std::vector<float> nx, ny, nz;
+            std::vector<float> normal2;     //Each normal dotted with itself, which is less than 1 where a cell's samples disagree
+            std::vector<float> depth;
+            std::vector<float> depthWeight; //1 / (DEPTH_SIGMA times how fast depth changes across the cell)
+        };
+
+        void depthWeightRow(int y);
+        void filterRow(int y, float *__restrict sums);
+
+        const AuxBuffers& aux;
+        Planes planes, filtered;
+        Guide guide;
+        int pass = 0;                       //The first finds depthWeight, the rest are the iterations
+        float colorWeight;
+};
+
+#endif
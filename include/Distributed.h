@@ -0,0 +1,54 @@
+#ifndef DISTRIBUTED_H
+#define DISTRIBUTED_H
+
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include "Renderer.h"
+
+/*
+ * Renders frames across several processes. The coordinator listens on an
+ * address and hands out tiles to the workers that connect to it, a batch at
+ * a time whenever a worker asks for more, so faster workers take more tiles.
+ * Workers build the same named scene with the same settings and send back the
+ * colours of each tile exactly as traced, so the image is bit-identical to a
+ * single-process render. Addresses are as described in Socket.h.
+ */
+class RenderCoordinator {
+    public:
+        RenderCoordinator() = default;
+        ~RenderCoordinator();
+        RenderCoordinator(const RenderCoordinator&) = delete;
+        RenderCoordinator& operator=(const RenderCoordinator&) = delete;
+
+        bool listen(const std::string& address);
+        // Renders one frame on the connected workers, waiting for workers to connect if there are none
+        bool render(const std::string& sceneName, const RenderSettings& settings, std::vector<glm::vec3>& framebuffer);
+        void printWorkers() const;
+    private:
+        struct Worker {
+            int fd;
+            std::string name;           //Host and process id, from the worker's hello
+            int numThreads = 0;
+            std::vector<int> assigned;  //Tiles sent to the worker and not yet returned
+            int requested = 0;          //Tiles asked for and not yet sent
+            int tilesRendered = 0;      //In the last frame
+            bool hasJob = false;
+        };
+
+        void acceptWorker();
+        void dropWorker(size_t index, std::vector<int>& pending);
+        bool sendJob(Worker& worker);
+        bool receive(Worker& worker, std::vector<glm::vec3>& framebuffer, int& tilesReceived);
+
+        int listenFd = -1;
+        std::string unixPath;           //Removed again when the coordinator closes
+        std::vector<Worker> workers;
+        std::string job;                //Scene name and settings of the frame being rendered
+        RenderSettings frameSettings;
+};
+
+// Connects to the coordinator at address and renders tiles with numThreads threads until it closes the connection
+bool runRenderWorker(const std::string& address, int numThreads);
+
+#endif
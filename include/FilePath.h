@@ -7,7 +7,7 @@
 #include <unordered_map>
 using namespace std;
 
-std::filesystem::path getExtensionPath(const std::string& filePath){
+inline std::filesystem::path getExtensionPath(const std::string& filePath){
     static const std::unordered_map<std::string, std::filesystem::path> extensionMap = {
         {".obj", "Models"},
         {".off", "Models"},
@@ -30,7 +30,7 @@ std::filesystem::path getExtensionPath(const std::string& filePath){
     return "";
 }
 
-std::string getFilePath(const std::string& fileName){
+inline std::string getFilePath(const std::string& fileName){
     std::filesystem::path currentFilePath = std::filesystem::absolute(std::filesystem::path(__FILE__));
     std::filesystem::path baseDir = currentFilePath.parent_path().parent_path();
 
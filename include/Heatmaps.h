@@ -0,0 +1,26 @@
+#ifndef HEATMAPS_H
+#define HEATMAPS_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+/*
+ * Per-pixel cost of the last frame, summed over the pixel's anti-aliasing
+ * samples: BVH nodes visited, objects tested, the deepest bounce reached and
+ * the wall-clock time spent on the pixel. Row-major from the bottom left,
+ * like the framebuffer.
+ */
+struct Heatmaps {
+    int width = 0;
+    int height = 0;
+    std::vector<uint32_t> nodeVisits;
+    std::vector<uint32_t> primitiveTests;
+    std::vector<uint32_t> bounceDepth;
+    std::vector<float> nanoseconds;
+
+    void resize(int width, int height);
+    bool write(const std::string& prefix) const;
+};
+
+#endif
@@ -0,0 +1,14 @@
+#ifndef IMAGEWRITER_H
+#define IMAGEWRITER_H
+
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+
+// Writes pixels (row-major from the bottom left, components in [0, 1]) as a 24-bit BMP
+bool writeBMP(const std::string& path, int width, int height, const std::vector<glm::vec3>& pixels);
+
+// Maps t in [0, 1] onto a black, blue, cyan, green, yellow, red, white ramp
+glm::vec3 falseColour(float t);
+
+#endif
@@ -0,0 +1,82 @@
+#ifndef LIGHT_H
+#define LIGHT_H
+
+#include <glm/glm.hpp>
+
+/*
+ * Light arriving at a shaded point from one sample on a light source.
+ */
+struct LightSample {
+    glm::vec3 dir = glm::vec3(0);      //Unit vector from the shaded point towards the light
+    float dist = 0;                    //Distance to the sampled point, shadow rays stop here
+    glm::vec3 radiance = glm::vec3(0); //Light arriving at the shaded point, before shadowing
+};
+
+/*
+ * Generic light source. Lights are sampled from a shaded point p; (u1, u2)
+ * are uniform random numbers used by lights with an area.
+ */
+class Light {
+    protected:
+        glm::vec3 color_ = glm::vec3(1);
+        float intensity_ = 1;
+    public:
+        Light(glm::vec3 color, float intensity) : color_(color), intensity_(intensity) {}
+        virtual ~Light() {}
+
+        virtual LightSample sample(const glm::vec3& p, float u1, float u2) = 0;
+        virtual float power();
+        virtual bool isDelta() { return true; }  //Lit from a single point or direction
+
+        glm::vec3 getColor() { return color_; }
+        float getIntensity() { return intensity_; }
+};
+
+class PointLight : public Light {
+    private:
+        glm::vec3 position;
+    public:
+        PointLight(glm::vec3 position, glm::vec3 color = glm::vec3(1), float intensity = 1) :
+            Light(color, intensity), position(position) {}
+        LightSample sample(const glm::vec3& p, float u1, float u2) override;
+};
+
+class DirectionalLight : public Light {
+    private:
+        glm::vec3 direction;  //Direction the light travels in
+    public:
+        DirectionalLight(glm::vec3 direction, glm::vec3 color = glm::vec3(1), float intensity = 1) :
+            Light(color, intensity), direction(glm::normalize(direction)) {}
+        LightSample sample(const glm::vec3& p, float u1, float u2) override;
+};
+
+class SpotLight : public Light {
+    private:
+        glm::vec3 position;
+        glm::vec3 direction;
+        float cosCutoff;  //Cosine of the half angle of the cone
+        float exponent;   //Falloff towards the edge of the cone
+    public:
+        SpotLight(glm::vec3 position, glm::vec3 direction, float cutoffDegrees, float exponent = 1,
+            glm::vec3 color = glm::vec3(1), float intensity = 1);
+        LightSample sample(const glm::vec3& p, float u1, float u2) override;
+        float power() override;
+};
+
+/*
+ * Parallelogram shaped area light spanning corner + s*edge1 + t*edge2, s,t in [0,1]
+ */
+class QuadLight : public Light {
+    private:
+        glm::vec3 corner;
+        glm::vec3 edge1;
+        glm::vec3 edge2;
+    public:
+        QuadLight(glm::vec3 corner, glm::vec3 edge1, glm::vec3 edge2, glm::vec3 color = glm::vec3(1), float intensity = 1) :
+            Light(color, intensity), corner(corner), edge1(edge1), edge2(edge2) {}
+        LightSample sample(const glm::vec3& p, float u1, float u2) override;
+        bool isDelta() override { return false; }
+        glm::vec3 getCenter() { return corner + 0.5f * (edge1 + edge2); }
+};
+
+#endif
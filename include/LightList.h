@@ -0,0 +1,28 @@
+#ifndef LIGHTLIST_H
+#define LIGHTLIST_H
+
+#include <vector>
+#include "Light.h"
+
+/*
+ * The lights in the scene, with an alias table over their power so a light
+ * can be picked in constant time with probability proportional to its power.
+ * Call build() after the last light is added.
+ */
+class LightList {
+    public:
+        void add(Light* light) { lights.push_back(light); }
+        void build();
+        void clear();       // deletes the lights
+        int sample(float u, float& pmf) const;
+
+        size_t size() const { return lights.size(); }
+        Light* operator[](size_t i) const { return lights[i]; }
+    private:
+        std::vector<Light*> lights;
+        std::vector<float> pmfs;   //Probability of picking each light
+        std::vector<float> probs;  //Probability of keeping bucket i instead of its alias
+        std::vector<int> aliases;
+};
+
+#endif
@@ -0,0 +1,25 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstddef>
+
+/*
+ * Read only memory mapping of a whole file.
+ * The mapping is released when the object is destroyed.
+ */
+class MappedFile {
+    public:
+        MappedFile(const char* filename);
+        ~MappedFile();
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        bool isOpen() const { return data != nullptr; }
+        const unsigned char* getData() const { return data; }
+        size_t getSize() const { return size; }
+    private:
+        const unsigned char* data = nullptr;
+        size_t size = 0;
+};
+
+#endif
@@ -0,0 +1,113 @@
+#ifndef MATERIAL_H
+#define MATERIAL_H
+
+#include <vector>
+#include <glm/glm.hpp>
+#include "Light.h"
+#include "SceneObject.h"
+#include "TextureCache.h"
+#include "RayDifferential.h"
+
+const size_t MAX_MATERIALS = 65536;     //Ids are 16 bits; material 0 is white, specular and nothing else
+
+struct LightingResult {
+    glm::vec3 ambient, diffuse, specular;
+};
+
+enum PatternType : uint8_t {
+    PATTERN_STRIPE,     //Bands of colours in turn along a direction in world space
+    PATTERN_CHECKER,    //Two colours alternating along the object's pattern axes
+    PATTERN_TEXTURE     //An image over the object's texture coordinates
+};
+
+/*
+ * A layer of a material, painted over the colour below it. Stripes and
+ * checkers are box filtered over the ray's footprint and textures are
+ * mip-mapped, so distant patterns fade to their average colour instead of
+ * aliasing.
+ */
+struct Pattern {
+    PatternType type = PATTERN_STRIPE;
+    float width = 1;                            //Width of a stripe or checker cell
+    glm::vec3 direction = glm::vec3(0, 0, 1);   //Stripes are laid along it
+    std::vector<glm::vec3> colors;              //The stripes in turn, or the two checker colours
+    TextureHandle texture;
+
+    glm::vec3 apply(const glm::vec3& below, SceneObject* obj, const glm::vec3& hit, const glm::vec2& uv,
+                    const RayDifferential& footprint) const;
+};
+
+/*
+ * How a surface looks: its colour and patterns, how it reflects, refracts
+ * and lets light through, and its highlights. Materials live in the scene's
+ * MaterialTable and objects refer to one by its id, so any number of objects
+ * share one.
+ */
+class Material {
+    public:
+        void setColor(glm::vec3 col) { color_ = col; }
+        void setReflectivity(bool flag, float refl_coeff) { refl_ = flag; reflc_ = refl_coeff; }
+        void setRefractivity(bool flag, float refr_coeff, float refr_index);
+        void setTransparency(bool flag, float tran_coeff) { tran_ = flag; tranc_ = tran_coeff; }
+        void setDielectric(bool flag, float refr_index) { diel_ = flag; refri_ = refr_index; }
+        void setShininess(float shininess) { shin_ = shininess; }
+        void setSpecularity(bool flag) { spec_ = flag; }
+
+        // Pattern layers, painted over the colour in the order they are added
+        void addStripe(float width, glm::vec3 direction, std::vector<glm::vec3> colors);
+        void addChecker(float width, glm::vec3 color1, glm::vec3 color2);
+        void addTexture(TextureHandle texture);
+
+        // The colour at hit, of obj; uv are the surface coordinates the intersection test gave
+        glm::vec3 colorAt(SceneObject* obj, const glm::vec3& hit, const glm::vec2& uv, const RayDifferential& footprint) const;
+        // Phong lighting of a point with the given normal and colour from each of the light samples
+        LightingResult lighting(const LightSample* lights, int numLights, const glm::vec3& viewVec,
+                                const glm::vec3& normalVec, const glm::vec3& color) const;
+
+        glm::vec3 getColor() const { return color_; }
+        float getReflectionCoeff() const { return reflc_; }
+        float getRefractionCoeff() const { return refrc_; }
+        float getTransparencyCoeff() const { return tranc_; }
+        float getRefractiveIndex() const { return refri_; }
+        float getShininess() const { return shin_; }
+        bool isReflective() const { return refl_; }
+        bool isRefractive() const { return refr_; }
+        bool isSpecular() const { return spec_; }
+        bool isTransparent() const { return tran_; }
+        bool isDielectric() const { return diel_; }     //Glass, reflecting and refracting by the Fresnel equations
+        bool isPatterned() const { return !layers_.empty(); }
+
+    private:
+        glm::vec3 color_ = glm::vec3(1);
+        float reflc_ = 0.0;  //coefficient of reflection
+        float refrc_ = 1.0;  //coefficient of refraction
+        float tranc_ = 1.0;  //coefficient of transparency
+        float refri_ = 1.0;  //refractive index
+        float shin_ = 50.0;  //shininess
+        bool refl_ = false;
+        bool refr_ = false;
+        bool spec_ = true;
+        bool tran_ = false;
+        bool diel_ = false;
+        std::vector<Pattern> layers_;
+};
+
+/*
+ * Every material in a scene, indexed by the 16-bit id objects store.
+ * Material 0 is the default one objects start with.
+ */
+class MaterialTable {
+    public:
+        MaterialTable() { clear(); }
+
+        // Adds a material and returns its id, or the default's once the table is full
+        MaterialId add(const Material& material);
+        void clear();       // leaves only the default material
+
+        size_t size() const { return materials.size(); }
+        const Material& operator[](MaterialId id) const { return materials[id]; }
+    private:
+        std::vector<Material> materials;
+};
+
+#endif
@@ -10,7 +10,6 @@
 #define H_PLANE
 
 #include <glm/glm.hpp>
-#include "TextureBMP.h"
 #include "SceneObject.h"
 
 class Plane : public virtual SceneObject
@@ -22,60 +21,43 @@ private:
 	glm::vec3 d_ = glm::vec3(0);
 	int nverts_ = 4;				//Number of vertices (3 or 4)
 
-	bool stripe_ = false; //stripe pattern: true/false
-	int stripeWidth_ = 0; //stripe width
-	glm::vec3 stripeDirection_ = glm::vec3(0); //stripe direction
-	std::vector<glm::vec3> stripeColors_; //stripe colors
+	//Set by precompute() whenever the vertices change
+	glm::vec3 normal_ = glm::vec3(0);	//Unit normal, along (c-b) x (a-b)
+	float planeD_ = 0;					//dot(normal_, a_), the plane is dot(normal_, p) = planeD_
+	glm::vec3 edgeU_ = glm::vec3(0);	//a->b, the u axis
+	glm::vec3 edgeV_ = glm::vec3(0);	//a->d for quads and a->c for triangles, the v axis
+	glm::vec3 invU_ = glm::vec3(0);		//Dual basis: u = dot(q-a, invU_), v = dot(q-a, invV_)
+	glm::vec3 invV_ = glm::vec3(0);
+	bool parallelogram_ = true;			//Quads that are not are tested as triangles abc and acd
+	glm::vec3 triU_[2], triV_[2];		//Dual bases of those triangles, (b-a, c-a) and (c-a, d-a)
+	glm::vec3 checkerAxis1_ = glm::vec3(0);	//c->b and b->a, normalised
+	glm::vec3 checkerAxis2_ = glm::vec3(0);
 
-	bool tex_ = false;
-	glm::vec2 texA_ = a_;   //The texture coordinates of the quad
-	glm::vec2 texB_ = c_;
-	TextureBMP texture_;
-
-	bool checkered_ = false; //checkered pattern: true/false
-	int checkeredWidth_ = 0; //checkered width
-	glm::vec3 checkeredColor1_ = glm::vec3(0); //checkered color 1
-	glm::vec3 checkeredColor2_ = glm::vec3(0); //checkered color 2
-	
 protected:
 	void calculateAABB() override;
+	void precompute();
+	bool contains(const glm::vec3& q, float u, float v);
 
 public:	
 	Plane() = default;
 	
 	Plane(glm::vec3 pa, glm::vec3 pb, glm::vec3 pc, glm::vec3 pd) : 
-		a_(pa), b_(pb), c_(pc), d_(pd), nverts_(4) { calculateAABB(); }
+		a_(pa), b_(pb), c_(pc), d_(pd), nverts_(4) { precompute(); calculateAABB(); }
 
 	Plane(glm::vec3 pa, glm::vec3 pb, glm::vec3 pc) :
-		a_(pa), b_(pb), c_(pc),  nverts_(3) { calculateAABB(); }
+		a_(pa), b_(pb), c_(pc),  nverts_(3) { precompute(); calculateAABB(); }
 
 
-	bool isInside(glm::vec3 pt);
+	bool isInside(const glm::vec3& pt);
 	int getNumVerts();
 
-	float intersect(glm::vec3 posn, glm::vec3 dir) override;
-	glm::vec3 normal(glm::vec3 pt) override;
-	glm::vec3 getColor(glm::vec3 hit) override;
-
-	void setStripe(bool flag, int stripeWidth, glm::vec3 stripeDirection, std::vector<glm::vec3> stripeColors);
-	void setStripe(bool flag) { stripe_ = flag; }
-	void setStripeWidth(int stripeWidth) { stripeWidth_ = stripeWidth; }
-	void setStripeDirection(glm::vec3 stripeDirection) { stripeDirection_ = stripeDirection; }
-	void addStripeColor(glm::vec3 color) { stripeColors_.push_back(color); }
-	bool isStripe() { return stripe_; }
-
-	void setCheckered(bool flag, int width, glm::vec3 color1, glm::vec3 color2);
-	void setCheckered(bool flag) { checkered_ = flag; }
-	void setCheckeredWidth(int width) { checkeredWidth_ = width; }
-	void setCheckeredColor1(glm::vec3 color1) { checkeredColor1_ = color1; }
-	void setCheckeredColor2(glm::vec3 color2) { checkeredColor2_ = color2; }
-	bool isCheckered() { return checkered_; }
-
-	void setTextured(bool flag);
-	void setTexture(TextureBMP file);
-	void setTexArea(glm::vec2 a, glm::vec2 b);
-	bool isTextured() { return tex_; }
-
+	float intersect(const glm::vec3& posn, const glm::vec3& dir) override;
+	float intersectUV(const glm::vec3& posn, const glm::vec3& dir, glm::vec2& uv) override;
+	glm::vec3 normal(const glm::vec3& pt) override;
+	void translate(glm::vec3 offset) override;
+	SceneObject* clone(Arena& arena) const override { return arena.create<Plane>(*this); }
+	void patternAxes(const glm::vec3& hit, glm::vec3& axis1, glm::vec3& axis2) override;
+	bool textureCoords(const glm::vec3& hit, const glm::vec2& uv, const RayDifferential& footprint, glm::vec2& st, float& filterWidth) override;
 };
 
 #endif //!H_PLANE
@@ -0,0 +1,66 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <mutex>
+#include <atomic>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdint>
+
+/*
+ * Records timed scopes while a capture is running and writes them in the
+ * Chrome trace event format, viewable in chrome://tracing or Perfetto.
+ * Outside a capture each scope costs one relaxed atomic load.
+ */
+class Profiler {
+    public:
+        static void start();
+        static bool stop(const std::string& path);
+        static bool isRunning() { return running.load(std::memory_order_relaxed); }
+
+        // Names the calling thread's track; id picks its row in the viewer
+        static void setThread(int id, const std::string& name);
+        static void record(const char* name, const char* category, std::chrono::steady_clock::time_point start,
+                           std::chrono::steady_clock::time_point end, int64_t arg);
+    private:
+        struct Event {
+            const char* name;
+            const char* category;
+            int tid;
+            double startUs;
+            double durationUs;
+            int64_t arg;
+        };
+
+        static std::atomic<bool> running;
+        static std::mutex mutex;
+        static std::vector<Event> events;
+        static std::vector<std::pair<int, std::string>> threadNames;
+        static std::chrono::steady_clock::time_point origin;
+};
+
+/*
+ * Times the enclosing block. arg is shown with the event, e.g. the first
+ * pixel of a batch, or -1 for none. name and category must outlive the capture.
+ */
+class ProfileScope {
+    public:
+        ProfileScope(const char* name, const char* category = "frame", int64_t arg = -1)
+            : name(name), category(category), arg(arg), active(Profiler::isRunning()) {
+            if (active) start = std::chrono::steady_clock::now();
+        }
+        ~ProfileScope() {
+            if (active) Profiler::record(name, category, start, std::chrono::steady_clock::now(), arg);
+        }
+        ProfileScope(const ProfileScope&) = delete;
+        ProfileScope& operator=(const ProfileScope&) = delete;
+    private:
+        const char* name;
+        const char* category;
+        int64_t arg;
+        bool active;
+        std::chrono::steady_clock::time_point start;
+};
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef RANDOM_H
+#define RANDOM_H
+
+#include <cstdint>
+
+/*
+ * PCG32 random number generator (pcg-random.org).
+ * Small enough to live on the stack of each worker, so threads never share
+ * generator state. Seeding from the pixel index keeps renders reproducible
+ * regardless of which thread traces which pixel.
+ */
+class Random {
+    public:
+        Random(uint64_t seed, uint64_t stream = 1) {
+            state = 0;
+            inc = (stream << 1) | 1;
+            next();
+            state += seed;
+            next();
+        }
+
+        uint32_t next() {
+            uint64_t old = state;
+            state = old * 6364136223846793005ULL + inc;
+            uint32_t xorshifted = (uint32_t)(((old >> 18) ^ old) >> 27);
+            uint32_t rot = (uint32_t)(old >> 59);
+            return (xorshifted >> rot) | (xorshifted << ((-rot) & 31));
+        }
+
+        // uniform float in [0, 1)
+        float nextFloat() {
+            return (next() >> 8) * (1.0f / 16777216.0f);
+        }
+
+        // For saving a generator and restoring it on the same stream
+        uint64_t getState() const { return state; }
+        void setState(uint64_t state) { this->state = state; }
+    private:
+        uint64_t state;
+        uint64_t inc;
+};
+
+#endif
@@ -7,22 +7,33 @@
 #define H_RAY
 #include <glm/glm.hpp>
 #include <vector>
-#include "BVH.h"
+#include <cstddef>
+#include "RayHit.h"
 #include "SceneObject.h"
 
-class Ray
+class BVH;
+
+/*
+ * The first 32 bytes are all intersection tests read: the origin and tMin,
+ * then the direction and tMax, each packed into 16 bytes. Hits are only
+ * accepted between tMin and tMax, and finding one lowers tMax to it. The
+ * 16-byte hit follows, and that is all: the ray differentials of camera
+ * rays and their bounces travel beside the ray in the renderer, so shadow
+ * rays never carry them.
+ */
+class alignas(16) Ray
 {
 
 public:
 	glm::vec3 p0 = glm::vec3(0);		//The source point of the ray
+	float tMin = 0.0f;					//The nearest distance a hit is accepted at
 	glm::vec3 dir = glm::vec3(0,0,-1);	//The UNIT direction of the ray
-	glm::vec3 hit = glm::vec3(0);		//The closest point of intersection on the ray
-	int index = -1;						//The index of the object that gives the closet point of intersection
-	float dist = 0;						//The distance from the p0 to hit along the ray.
+	float tMax = 1.e+6;					//The farthest distance a hit is accepted at
+	RayHit hit;							//The closest intersection found by closestPt()
 
 	Ray() {}		//Default constructor
 
-	Ray(glm::vec3 source, glm::vec3 direction)
+	Ray(const glm::vec3& source, const glm::vec3& direction)
 	{
 		const float RSTEP = 0.005f;
 		p0 = source;
@@ -31,9 +42,9 @@ public:
 	}
 
 	int closestPt(std::vector<SceneObject*>& sceneObjects);
-	int closestPt(BVH &bvh);
-
-	void setRay(glm::vec3 source, glm::vec3 direction)
+	int closestPt(BVH &bvh, int *nodeVisits = nullptr);
+	glm::vec3 hitPoint() const { return p0 + dir * hit.t; }
+	void setRay(const glm::vec3& source, const glm::vec3& direction)
 	{
 		const float RSTEP = 0.005f;
 		p0 = source;
@@ -41,4 +52,7 @@ public:
 		p0 = p0 + RSTEP * dir;   //Ray stepping
 	}
 };
+
+static_assert(offsetof(Ray, hit) == 32, "the origin, direction and their limits should fill 32 bytes");
+static_assert(sizeof(Ray) == 48, "a ray should be its 32 bytes and the 16-byte hit");
 #endif
@@ -0,0 +1,32 @@
+#ifndef RAYDIFFERENTIAL_H
+#define RAYDIFFERENTIAL_H
+
+#include <cmath>
+#include <algorithm>
+#include <glm/glm.hpp>
+
+/*
+ * Ray differentials (Igehy 1999): how a ray's origin and direction change
+ * when moving one pixel across (x) or up (y) the image. Evaluated at a hit
+ * point, dPdx and dPdy span the pixel's footprint on the surface.
+ */
+struct RayDifferential {
+	glm::vec3 dPdx = glm::vec3(0);
+	glm::vec3 dPdy = glm::vec3(0);
+	glm::vec3 dDdx = glm::vec3(0);
+	glm::vec3 dDdy = glm::vec3(0);
+
+	static RayDifferential primary(glm::vec3 dir, glm::vec3 dx, glm::vec3 dy);
+
+	RayDifferential transfer(glm::vec3 dir, float t, glm::vec3 n) const;
+	RayDifferential reflect(glm::vec3 dir, glm::vec3 n, glm::vec3 dndx, glm::vec3 dndy) const;
+	RayDifferential refract(glm::vec3 dir, glm::vec3 n, glm::vec3 dndx, glm::vec3 dndy, float eta) const;
+	RayDifferential scatter(glm::vec3 dir, float spread) const;
+
+	//Width of the footprint along the largest of the two pixel axes
+	float width() const { return std::max(glm::length(dPdx), glm::length(dPdy)); }
+	//Width of the footprint along the unit vector axis
+	float width(glm::vec3 axis) const { return std::max(std::fabs(glm::dot(dPdx, axis)), std::fabs(glm::dot(dPdy, axis))); }
+};
+
+#endif
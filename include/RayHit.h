@@ -0,0 +1,22 @@
+#ifndef RAYHIT_H
+#define RAYHIT_H
+
+#include <cstdint>
+
+/*
+ * The closest intersection found along a ray, 16 bytes so four fit in a
+ * cache line. The hit point is not stored; Ray::hitPoint() reconstructs it
+ * from t when shading needs it.
+ */
+struct alignas(16) RayHit {
+    float t = -1.0f;        // distance along the ray, negative on a miss
+    int32_t primID = -1;    // index of the object hit in the scene's objects
+    float u = 0.0f;         // surface coordinates of the hit, for objects that provide them
+    float v = 0.0f;
+
+    bool isHit() const { return primID >= 0; }
+};
+
+static_assert(sizeof(RayHit) == 16, "RayHit should be 16 bytes");
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef RAYSTATS_H
+#define RAYSTATS_H
+
+#include <cstdint>
+
+// Building without RAY_STATS compiles every counter out of the hot path
+#ifdef RAY_STATS
+#define RAY_STAT(statement) statement
+#else
+#define RAY_STAT(statement)
+#endif
+
+const int CACHE_LINE_SIZE = 64;
+const int BOUNCE_DEPTH_BINS = 16;	//Deeper bounces are counted in the last bin
+
+/*
+ * Ray and traversal counters for one frame. Each worker thread fills its own
+ * copy, aligned to a cache line so no two threads write to the same line, and
+ * the copies are merged once the frame is done.
+ */
+struct alignas(CACHE_LINE_SIZE) RayStats {
+	uint64_t primaryRays = 0;
+	uint64_t shadowRays = 0;
+	uint64_t secondaryRays = 0;			//Reflected, refracted and transmitted rays
+	uint64_t occludedShadowRays = 0;	//Shadow rays blocked before reaching the light
+	uint64_t shadingPoints = 0;			//Hits the lights were sampled from
+	uint64_t areaLightTests = 0;		//Soft shadow tests of an area light from a hit
+	uint64_t probeShadowRays = 0;		//Shadow rays of the four probes each soft shadow test starts with
+	uint64_t penumbraShadowRays = 0;	//Shadow rays into the remaining strata, where the probes disagreed
+	uint64_t nodeVisits = 0;			//BVH nodes whose bounding box was tested
+	uint64_t primitiveTests = 0;		//Object intersection tests
+	uint64_t bounceDepth[BOUNCE_DEPTH_BINS] = {};	//Rays traced at each recursion depth, 0 is primary
+
+	void add(const RayStats& other);
+	void print() const;
+
+	uint64_t totalRays() const { return primaryRays + shadowRays + secondaryRays; }
+	uint64_t intersections() const { return nodeVisits + primitiveTests; }
+	float occlusionRate() const { return shadowRays > 0 ? static_cast<float>(occludedShadowRays) / shadowRays : 0.0f; }
+	float shadowRaysPerPoint() const { return shadingPoints > 0 ? static_cast<float>(shadowRays) / shadingPoints : 0.0f; }
+};
+
+#endif
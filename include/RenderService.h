@@ -0,0 +1,40 @@
+#ifndef RENDERSERVICE_H
+#define RENDERSERVICE_H
+
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include "Renderer.h"
+
+struct ServiceSettings {
+    int numThreads = 25;                // tracing threads shared by every job
+    int maxActiveJobs = 2;              // jobs traced at once, the rest wait in the queue
+    int maxQueuedJobs = 64;             // jobs submitted beyond this many waiting are rejected
+    std::vector<std::string> preload;   // scenes built as the service starts
+};
+
+/*
+ * A long-running render service. Clients connect to address and submit jobs:
+ * a named scene, a priority and render settings, which can move the camera
+ * with eye and look-at. Each scene is built once, the first time a job or
+ * preload names it, and then stays resident with its BVH and textures for
+ * every later job, so a job costs only its tracing.
+ *
+ * Jobs wait in a queue until one of maxActiveJobs slots is free and their
+ * scene is built, highest priority first and in order of submission within
+ * a priority. Active jobs share one pool of numThreads threads a tile at a
+ * time, the highest priority job's tiles first; a job's threads setting caps
+ * how many of them it takes at once. Frames to be denoised are filtered on
+ * the same pool, a band of rows at a time. Each finished image is sent back
+ * to the client that submitted it, bit-identical to a render in one process.
+ * Jobs of a client that disconnects are cancelled.
+ *
+ * Runs until SIGINT or SIGTERM, returns false if it could not start.
+ */
+bool runRenderService(const std::string& address, const ServiceSettings& service);
+
+// Submits a job to the service at address and waits for its image
+bool submitRenderJob(const std::string& address, const std::string& sceneName, const RenderSettings& settings,
+                     int priority, std::vector<glm::vec3>& image);
+
+#endif
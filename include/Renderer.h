@@ -0,0 +1,120 @@
+#ifndef RENDERER_H
+#define RENDERER_H
+
+#include <atomic>
+#include <vector>
+#include <glm/glm.hpp>
+#include "Scene.h"
+#include "Ray.h"
+#include "Random.h"
+#include "RayStats.h"
+#include "Heatmaps.h"
+#include "Denoiser.h"
+#include "Camera.h"
+
+const int MAX_LIGHT_SAMPLES = 4;	//Shadow rays per shading point when there are more lights than this
+const int SHADOW_STRATA = 4;		//Area lights are split into SHADOW_STRATA x SHADOW_STRATA cells
+static_assert(SHADOW_STRATA % 2 == 0, "shadow probes need a quadrant each");
+const int TILE_SIZE = 16;			//Workers take the image in TILE_SIZE x TILE_SIZE tiles
+const int ROULETTE_DEPTH = 3;		//Bounces a path is traced for before Russian roulette may end it
+const float DIFFUSE_SPREAD = 0.125f;	//Radians a path's footprint widens by per unit distance after a diffuse bounce
+
+struct Accumulation;
+
+struct RenderSettings {
+	int numThreads = 25;
+	int width = 800;			//Number of cells across the image
+	int height = 800;			//Number of cells up the image
+	int maxSteps = 10;			//Maximum recursion depth of trace()
+	int splitDepth = 3;			//Dielectrics trace both reflection and refraction to this depth, one picked by its Fresnel weight deeper
+	float fov = 0.0;			//Overrides the scene camera's vertical field of view (degrees) when set
+	float aperture = -1.0;		//Overrides the scene camera's lens radius when set, 0 for a pinhole
+	float focusDistance = 0.0;	//Overrides the scene camera's focus distance when set
+	bool overrideEye = false;
+	glm::vec3 eye = glm::vec3(0);			//Overrides the scene camera's position when overrideEye
+	bool overrideLookAt = false;
+	glm::vec3 lookAt = glm::vec3(0, 0, -1);	//Overrides the point the scene camera looks at when overrideLookAt
+	bool enableAA = true;
+	int aaSamples = 2;			//Samples along each axis of a cell when anti-aliasing
+	bool enableBVH = false;
+	bool pathTrace = false;		//Monte Carlo path tracing instead of Whitted ray tracing
+	bool denoise = false;		//Filter the noise out of each frame once it is traced, see denoise()
+	bool printRayDebug = false;	//Print the frame's RayStats after each frame
+	bool recordHeatmaps = false;	//Record the cost of each pixel into getHeatmaps()
+};
+
+// Cells [x0, x1) x [y0, y1) of a tile. Tiles are numbered across then up from the bottom left.
+struct TileRect {
+	int x0, y0, x1, y1;
+	int numCells() const { return (x1 - x0) * (y1 - y0); }
+};
+int tileCount(int width, int height);
+TileRect tileRect(int tile, int width, int height);
+
+/*
+ * Traces every cell of the image into a framebuffer through the scene's
+ * camera. settings.numThreads worker threads take tiles of the image in turn
+ * and generate their primary rays as they go. Every cell's colour depends only
+ * on its position, so tiles can be rendered in any order, or by other processes. Does not depend on GLUT, so
+ * scenes can be rendered headless.
+ */
+class Renderer {
+	public:
+		Renderer(Scene *scene, const RenderSettings& settings);
+		Renderer(const Renderer&) = delete;
+		Renderer& operator=(const Renderer&) = delete;
+
+		void render();
+		// render() in two steps, for rendering a subset of the tiles: beginFrame() then renderTiles() any number of times
+		void beginFrame();
+		void renderTiles(const std::vector<int>& tiles);
+		// Traces one tile on the calling thread, for callers running their own threads
+		void renderTile(int tile, RayStats& rayStats);
+		// Progressive rendering: adds a sample to every cell of accumulation, and their means to the framebuffer
+		void renderPass(Accumulation& accumulation);
+		// Filters the framebuffer once every tile is traced, guided by the aux buffers traced with it.
+		// render() calls it itself when settings.denoise is set; after renderPass() it is the caller's to call.
+		void denoise();
+		// Takes the image of a Denoiser of the frame as the framebuffer, for callers running its passes on their own threads
+		void finishDenoise(const Denoiser& denoiser) { denoiser.getImage(framebuffer); }
+		void printRayDebug();
+
+		RenderSettings& getSettings() { return settings; }
+		const RayStats& getStats() const { return stats; }
+		int getWidth() const { return settings.width; }
+		int getHeight() const { return settings.height; }
+		//Colour of cell (i, j), i across and j up from the bottom left
+		const glm::vec3& getPixel(int i, int j) const { return framebuffer[j * settings.width + i]; }
+		const std::vector<glm::vec3>& getFramebuffer() const { return framebuffer; }
+		const Heatmaps& getHeatmaps() const { return heatmaps; }
+		const AuxBuffers& getAuxBuffers() const { return aux; }
+		int getNumTiles() const { return tileCount(settings.width, settings.height); }
+	private:
+		// diff is the ray's differentials. Given aux, these also record what the ray first sees in it, for the denoiser
+		glm::vec3 traceSample(Ray& ray, const RayDifferential& diff, Random& rng, RayStats& rayStats, AuxSample* aux = nullptr);
+		glm::vec3 trace(Ray& ray, const RayDifferential& diff, float eta_1, int step, Random& rng, RayStats& rayStats,
+						AuxSample* aux = nullptr);
+		glm::vec3 traceDielectric(Ray& ray, SceneObject* obj, const glm::vec3& normalVec, const RayDifferential& footprint,
+								  float eta_1, int step, Random& rng, RayStats& rayStats);
+		glm::vec3 tracePath(Ray& ray, const RayDifferential& diff, Random& rng, RayStats& rayStats, AuxSample* aux = nullptr);
+		void closestPt(Ray& ray, RayStats& rayStats);
+		float shadowTransmittance(const glm::vec3& hit, const LightSample& light, int objIndex, RayStats& rayStats);
+		float areaLightVisibility(const glm::vec3& hit, Light* light, int objIndex, Random& rng, RayStats& rayStats);
+		int sampleLights(const glm::vec3& hit, int objIndex, LightSample* samples, Random& rng, RayStats& rayStats);
+		glm::vec3 renderPixel(int i, int j, RayStats& rayStats);
+		glm::vec3 accumulatePixel(int i, int j, RayStats& rayStats);
+		void renderWorker(int worker, const std::vector<int> *tiles, RayStats *rayStats);
+		void traceFrame();
+
+		Scene *scene;
+		RenderSettings settings;
+		RayStats stats;
+		std::vector<glm::vec3> framebuffer;
+		Heatmaps heatmaps;
+		AuxBuffers aux;				//Albedo, normals and depth of the frame, traced when settings.denoise is set
+		Camera camera;				//The scene's camera with the settings' overrides, for the current frame
+		std::atomic<int> nextTile;	//Index into the tiles being rendered of the next one to take
+		Accumulation *accumulation = nullptr;	//Set during renderPass()
+};
+
+#endif
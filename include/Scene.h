@@ -0,0 +1,74 @@
+#ifndef SCENE_H
+#define SCENE_H
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <functional>
+#include "SceneObject.h"
+#include "Material.h"
+#include "LightList.h"
+#include "TextureCache.h"
+#include "BVH.h"
+#include "Camera.h"
+#include "Arena.h"
+
+/*
+ * Everything the renderer needs: the objects, their materials, the lights,
+ * the BVH over the objects and the camera. Call build() once all objects and lights are added.
+ * Animated scenes also have a camera path and a function that moves their
+ * objects; update() poses the scene at a time without rebuilding the BVH.
+ *
+ * Objects are created with add() in the scene's arena. build() copies them
+ * into a fresh one in the order the BVH visits them, so they move; an object
+ * is found again from the id add() gave it with object(id).
+ */
+struct Scene {
+	std::vector<SceneObject*> objects;
+	MaterialTable materials;		//Indexed by each object's material id
+	LightList lights;
+	BVH *bvh = nullptr;
+	Camera camera;
+	CameraPath cameraPath;
+	std::function<void(Scene&, float)> animate;	//Moves objects to where they are at a time in seconds
+
+	Scene() = default;
+	~Scene();
+	Scene(const Scene&) = delete;
+	Scene& operator=(const Scene&) = delete;
+
+	// Creates an object owned by the scene and adds it, returns it for setting up
+	template <typename T, typename... Args>
+	T* add(Args&&... args) {
+		T* obj = arena.create<T>(std::forward<Args>(args)...);
+		obj->setId(objects.size());
+		objects.push_back(obj);
+		return obj;
+	}
+	SceneObject* object(int id);
+
+	void build();
+	void update(float time);
+	void clear();	//Frees every object, material, light and the BVH, leaving an empty scene
+
+private:
+	void packObjects();
+
+	Arena arena;					//Owns the objects
+	std::vector<int> objectIndex;	//Index in objects of each id, once build() has moved them
+};
+
+// Scene builders, each adds its objects and lights to scene
+void buildDemoScene(Scene& scene, TextureCache& textureCache, const bool areaLight = false);
+void drawCircles(Scene& scene, const int numSpheres, const bool useRandomPlacement);
+void buildMirrorCorridor(Scene& scene);
+void buildGlassSpheres(Scene& scene);
+void buildMesh(Scene& scene, const int numTriangles);
+void buildManyLights(Scene& scene, const int numLights);
+
+// The builders by name, with a key light added to scenes that have none and
+// rand() reseeded first, so every process builds the same objects
+const std::vector<std::string>& sceneNames();
+bool buildScene(const std::string& name, Scene& scene, TextureCache& textureCache);
+
+#endif
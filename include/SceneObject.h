@@ -14,68 +14,46 @@
 #define H_SOBJECT
 #include <glm/glm.hpp>
 #include <vector>
+#include <cstdint>
 #include "AABB.h"
+#include "Arena.h"
+#include "Light.h"
+#include "RayDifferential.h"
 
-typedef struct {
-	glm::vec3 ambient, diffuse, specular;
-} LightingResult;
+typedef uint16_t MaterialId;	//Index in the scene's MaterialTable
+const MaterialId DEFAULT_MATERIAL = 0;
 
 class SceneObject {
 protected:
 	virtual void calculateAABB() = 0;
 
 	int id_;
+	MaterialId material_ = DEFAULT_MATERIAL;
 
 	AABB aabb_; //Axis-aligned bounding box
-	glm::vec3 color_ = glm::vec3(1);  //material color
-	bool refl_ = false;  //reflectivity: true/false
-	bool refr_ = false;  //refractivity: true/false
-	bool spec_ = true;   //specularity: true/false
-	bool tran_ = false;  //transparency: true/false
-	float reflc_ = 0.0;  //coefficient of reflection
-	float refrc_ = 1.0;  //coefficient of refraction
-	float tranc_ = 1.0;  //coefficient of transparency
-	float refri_ = 1.0;  //refractive index
-	float shin_ = 50.0; //shininess
-
-
 
 public:
 	SceneObject() {}
-    virtual float intersect(glm::vec3 p0, glm::vec3 dir) = 0;
-	virtual glm::vec3 normal(glm::vec3 pos) = 0;
+    virtual float intersect(const glm::vec3& p0, const glm::vec3& dir) = 0;
+	//As intersect(), also giving the surface coordinates of the hit for objects that have them
+	virtual float intersectUV(const glm::vec3& p0, const glm::vec3& dir, [[maybe_unused]] glm::vec2& uv) { return intersect(p0, dir); }
+	virtual glm::vec3 normal(const glm::vec3& pos) = 0;
+	virtual void translate(glm::vec3 offset) = 0;	//Moves the object and its bounding box
+	virtual SceneObject* clone(Arena& arena) const = 0;	//A copy of the object, owned by arena
 	virtual ~SceneObject() {}
 
-	virtual LightingResult lighting(glm::vec3 lightPos, glm::vec3 viewVec, glm::vec3 hit);
-	virtual glm::vec3 getColor(glm::vec3 hit);
-	
+	//The two unit axes checker patterns are laid along at hit
+	virtual void patternAxes(const glm::vec3& hit, glm::vec3& axis1, glm::vec3& axis2);
+	//Texture coordinates of hit and the footprint's width in them, false where there is no texture.
+	//uv are the surface coordinates the intersection test gave.
+	virtual bool textureCoords(const glm::vec3& hit, const glm::vec2& uv, const RayDifferential& footprint, glm::vec2& st, float& filterWidth);
+
 	void setId(int id) { id_ = id; }
 	int getId() { return id_; }
-	float intersectAABB(glm::vec3 p0, glm::vec3 dir);
-	void setColor(glm::vec3 col);
-	void setReflectivity(bool flag);
-	void setReflectivity(bool flag, float refl_coeff);
-	void setRefractivity(bool flag);
-	void setRefractivity(bool flag, float refr_coeff, float refr_indx);
-	void setShininess(float shininess);
-	void setSpecularity(bool flag);
-	void setTransparency(bool flag);
-	void setTransparency(bool flag, float tran_coeff);
-	void setStripe(bool flag);
-	void addStripeColor(glm::vec3 color);
-	void setStripeWidth(int width);
-	void setStripeDirection(glm::vec3 direction);
+	float intersectAABB(const glm::vec3& p0, const glm::vec3& dir);
+	void setMaterial(MaterialId material) { material_ = material; }
+	MaterialId getMaterial() const { return material_; }
 	AABB getBBox();
-	float getReflectionCoeff();
-	float getRefractionCoeff();
-	float getTransparencyCoeff();
-	float getRefractiveIndex();
-	float getShininess();
-	bool isStripe();
-	bool isReflective();
-	bool isRefractive();
-	bool isSpecular();
-	bool isTransparent();
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,43 @@
+#ifndef SOCKET_H
+#define SOCKET_H
+
+#include <string>
+#include <cstdint>
+
+/*
+ * Framed messages over stream sockets, shared by the distributed renderer
+ * and the render service. Every message is a type and a payload length, both
+ * 32-bit big endian, followed by the payload. Integers in payloads are 32-bit
+ * big endian too, and colours are sent as the bits of their floats.
+ *
+ * Addresses are "host:port" for TCP (an empty host listens on every
+ * interface) or "unix:path" for a Unix domain socket.
+ */
+
+const uint32_t MAX_PAYLOAD = 64 << 20;
+
+void putU32(std::string& buf, uint32_t v);
+uint32_t getU32(const std::string& buf, size_t offset);
+void putFloat(std::string& buf, float f);
+float getFloat(const std::string& buf, size_t offset);
+
+// The 8 bytes framing a message of size bytes, for payloads written straight after them
+void putHeader(std::string& buf, uint32_t type, uint32_t size);
+
+bool sendMessage(int fd, uint32_t type, const std::string& payload);
+/*
+ * Sends as much of buf from sent on as the socket takes without blocking,
+ * advancing sent past it. Returns false when the connection is closed.
+ */
+bool sendPending(int fd, const std::string& buf, size_t& sent);
+// Returns false when the connection is closed or the payload is longer than maxPayload
+bool recvMessage(int fd, uint32_t& type, std::string& payload, uint32_t maxPayload = MAX_PAYLOAD);
+
+/*
+ * Opens a socket bound to address when listening, or connected to it
+ * otherwise. Returns -1 on failure; unixPath is set to the socket's path
+ * for Unix sockets.
+ */
+int openSocket(const std::string& address, bool listening, std::string& unixPath);
+
+#endif
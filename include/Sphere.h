@@ -10,7 +10,6 @@
 #define H_SPHERE
 #include <glm/glm.hpp>
 #include "SceneObject.h"
-#include "TextureBMP.h"
 
 /**
  * Defines a simple Sphere located at 'center'
@@ -20,22 +19,21 @@ class Sphere : public virtual SceneObject {
 private:
     glm::vec3 center = glm::vec3(0);
     float radius = 1;
-
-	bool tex_ = false;
-	TextureBMP texture_;
+    float radiusSq = 1;		//Cached for the intersection test
 protected:
 	void calculateAABB() override;
 public:
 	Sphere() { calculateAABB(); };  //Default constructor creates a unit sphere
-	Sphere(glm::vec3 c, float r) : center(c), radius(r) { calculateAABB(); };
+	Sphere(glm::vec3 c, float r) : center(c), radius(r), radiusSq(r * r) { calculateAABB(); };
 
-	float intersect(glm::vec3 p0, glm::vec3 dir) override;
-	glm::vec3 normal(glm::vec3 p) override;
-	glm::vec3 getColor(glm::vec3 hit) override;
+	float intersect(const glm::vec3& p0, const glm::vec3& dir) override;
+	glm::vec3 normal(const glm::vec3& p) override;
+	void translate(glm::vec3 offset) override { center += offset; calculateAABB(); }
+	SceneObject* clone(Arena& arena) const override { return arena.create<Sphere>(*this); }
+	bool textureCoords(const glm::vec3& hit, const glm::vec2& uv, const RayDifferential& footprint, glm::vec2& st, float& filterWidth) override;
 
-	void setTextured(bool flag);
-	void setTexture(TextureBMP color);
-	bool isTextured() { return tex_; }
+	glm::vec3 getCenter() const { return center; }
+	float getRadiusSq() const { return radiusSq; }
 };
 
 #endif //!H_SPHERE
@@ -0,0 +1,35 @@
+#ifndef SPHEREBATCH_H
+#define SPHEREBATCH_H
+
+#include <cstdint>
+#include <glm/glm.hpp>
+
+#define SPHERE_BATCH_WIDTH 8
+
+class Sphere;
+
+/*
+ * Up to eight spheres stored lane by lane, so one ray is tested against all
+ * of them with the same instructions in every lane and no virtual calls.
+ * The BVH keeps one for each leaf that holds only spheres.
+ */
+struct alignas(32) SphereBatch {
+    float centerX[SPHERE_BATCH_WIDTH] = {};
+    float centerY[SPHERE_BATCH_WIDTH] = {};
+    float centerZ[SPHERE_BATCH_WIDTH] = {};
+    float radiusSq[SPHERE_BATCH_WIDTH] = {};
+    int32_t primID[SPHERE_BATCH_WIDTH] = {};
+    int count = 0;                      // lanes in use
+
+    void add(const Sphere& sphere, int primID);
+    void set(int lane, const Sphere& sphere);
+
+    /*
+     * Finds the closest sphere hit with tMin < t < tMax. Returns its lane and
+     * sets t, or returns -1. Gives the same t as Sphere::intersect() for each
+     * sphere, and the first lane on a tie, as a scan over the spheres would.
+     */
+    int intersect(const glm::vec3& p0, const glm::vec3& dir, float tMin, float tMax, float& t) const;
+};
+
+#endif
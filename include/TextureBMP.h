@@ -5,26 +5,61 @@
 // Author:
 // R. Mukundan, Department of Computer Science and Software Engineering
 // University of Canterbury, Christchurch, New Zealand.
+//
+// Files are memory mapped and decoded once into RGBA8 texels stored in
+// 4x4 tiles (one tile per 64 byte cache line) with a precomputed
+// box-filtered mip chain. Textures are shared between objects through
+// TextureCache handles.
 //=====================================================================
 
 #if !defined(H_TEXBMP)
 #define H_TEXBMP
 
 #include <iostream>
-#include <fstream>
+#include <vector>
+#include <cstdint>
 #include <glm/glm.hpp>
 using namespace std;
 
+#define TEX_TILE_SIZE 4
+
+enum TextureFilter {
+    TEX_FILTER_NEAREST,
+    TEX_FILTER_BILINEAR,
+    TEX_FILTER_TRILINEAR
+};
+
 class TextureBMP
 {
     private:
-        int imageWid, imageHgt, imageChnls;  //Width, height, number of channels
-        char* imageData;
+        struct MipLevel {
+            int wid, hgt;                //Size of the level in texels
+            int tilesX;                  //Number of tiles in a row of the level
+            std::vector<uint32_t> texels; //Tiled RGBA8 texels
+        };
+
+        std::vector<MipLevel> mips;  //mips[0] is the full resolution image
+        TextureFilter filter = TEX_FILTER_TRILINEAR;
+
         bool loadBMPImage(const char* string);
+        void setLevel(MipLevel& level, int wid, int hgt, const std::vector<uint32_t>& linear);
+        void buildMipChain(std::vector<uint32_t> linear);
+        glm::vec3 fetch(const MipLevel& level, int i, int j) const;
+        glm::vec3 sampleNearest(const MipLevel& level, float u, float v) const;
+        glm::vec3 sampleBilinear(const MipLevel& level, float u, float v) const;
     public:
-		TextureBMP(): imageWid(0), imageHgt(0), imageChnls(0) {}
+        TextureBMP() {}
         TextureBMP(const char* string);
-        glm::vec3 getColorAt(float s, float t);
+        TextureBMP(const TextureBMP&) = delete;
+        TextureBMP& operator=(const TextureBMP&) = delete;
+        glm::vec3 getColorAt(float s, float t) const;
+        glm::vec3 getColorAt(float s, float t, float footprint) const;
+
+        void setFilter(TextureFilter filter) { this->filter = filter; }
+        TextureFilter getFilter() const { return filter; }
+        int getWidth() const { return mips.empty() ? 0 : mips[0].wid; }
+        int getHeight() const { return mips.empty() ? 0 : mips[0].hgt; }
+        int getNumLevels() const { return mips.size(); }
 };
 
 #endif
@@ -0,0 +1,31 @@
+#ifndef TEXTURECACHE_H
+#define TEXTURECACHE_H
+
+#include <memory>
+#include <mutex>
+#include <future>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include "TextureBMP.h"
+
+// Shared, immutable texture. Objects referencing the same file share one image.
+typedef std::shared_ptr<const TextureBMP> TextureHandle;
+
+/*
+ * Cache of decoded textures keyed by file path.
+ * Each file is mapped and decoded at most once, no matter how many
+ * objects reference it or how many threads request it at the same time.
+ */
+class TextureCache {
+    public:
+        TextureHandle load(const std::string& path);
+        void preload(const std::vector<std::string>& paths);
+        void purge();
+        size_t size();
+    private:
+        std::mutex mutex;
+        std::unordered_map<std::string, std::shared_future<TextureHandle>> textures;
+};
+
+#endif
@@ -6,7 +6,16 @@
  * Returns the cloest, positive 
  * intersection of the ray with the AABB
 */
-float AABB::intersect(glm::vec3 p0, glm::vec3 dir) {
+float AABB::intersect(const glm::vec3& p0, const glm::vec3& dir) {
+    float tmin, tmax;
+    if (!interval(p0, dir, tmin, tmax)) {
+        return -1.0f; // No intersection
+    }
+
+    return (tmin < 0) ? tmax : tmin;
+}
+
+bool AABB::interval(const glm::vec3& p0, const glm::vec3& dir, float& tNear, float& tFar) const {
     float t1 = (min.x - p0.x) / dir.x;
     float t2 = (max.x - p0.x) / dir.x;
     float t3 = (min.y - p0.y) / dir.y;
@@ -14,12 +23,21 @@ float AABB::intersect(glm::vec3 p0, glm::vec3 dir) {
     float t5 = (min.z - p0.z) / dir.z;
     float t6 = (max.z - p0.z) / dir.z;
 
-    float tmin = std::max(std::max(std::min(t1, t2), std::min(t3, t4)), std::min(t5, t6));
-    float tmax = std::min(std::min(std::max(t1, t2), std::max(t3, t4)), std::max(t5, t6));
-
-    if (tmax < 0 || tmin > tmax) {
-        return -1.0f; // No intersection
-    }
-
-    return (tmin < 0) ? tmax : tmin;
+    tNear = std::max(std::max(std::min(t1, t2), std::min(t3, t4)), std::min(t5, t6));
+    tFar = std::min(std::min(std::max(t1, t2), std::max(t3, t4)), std::max(t5, t6));
+    return tFar >= 0 && tNear <= tFar;
 }
+
+/*
+ * Returns the distance along the ray to where it
+ * enters the AABB, 0 if the ray starts inside it
+ * and -1 if the ray misses it
+*/
+float AABB::entryDistance(const glm::vec3& p0, const glm::vec3& dir) {
+    float t = intersect(p0, dir);
+    if (t < 0) return -1.0f;
+    bool inside = p0.x >= min.x && p0.x <= max.x &&
+                  p0.y >= min.y && p0.y <= max.y &&
+                  p0.z >= min.z && p0.z <= max.z;
+    return inside ? 0.0f : t;
+}
\ No newline at end of file
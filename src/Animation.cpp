@@ -0,0 +1,224 @@
+#include "Animation.h"
+#include <mutex>
+#include <deque>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <condition_variable>
+#include "Scene.h"
+#include "TextureCache.h"
+#include "ImageWriter.h"
+#include "Profiler.h"
+using namespace std;
+
+namespace {
+
+// One copy of the scene and the frame it is posed for
+struct FrameSlot {
+    Scene scene;
+    TextureCache textureCache;
+    unique_ptr<Renderer> renderer;
+    unique_ptr<Denoiser> denoiser;  // once the frame is traced, if the settings ask for it
+    int frame = -1;
+    int tasksLeft = 0;          // the frame's tiles, then the bands of each denoiser pass; guarded by the pipeline's mutex
+    bool finished = false;      // so is this
+};
+
+struct TileJob {
+    FrameSlot *slot;
+    int task;                   // a tile, or a band of the denoiser's pass
+};
+
+class AnimationPipeline {
+    public:
+        AnimationPipeline(const RenderSettings& settings, const AnimationSettings& animation)
+            : settings(settings), animation(animation) {}
+
+        bool run(const string& sceneName);
+    private:
+        bool buildSlot(FrameSlot& slot, const string& sceneName);
+        void startFrame(FrameSlot& slot, int frame);
+        void waitForFrame(FrameSlot& slot);
+        void traceWorker(int worker);
+
+        RenderSettings settings;
+        AnimationSettings animation;
+        FrameSlot slots[2];
+        vector<RayStats> threadStats;
+
+        mutex queueMutex;
+        condition_variable tilesQueued;
+        condition_variable frameFinished;
+        deque<TileJob> queue;
+        bool stopping = false;
+};
+
+bool AnimationPipeline::buildSlot(FrameSlot& slot, const string& sceneName) {
+    if (!buildScene(sceneName, slot.scene, slot.textureCache)) return false;
+    slot.scene.build();
+    slot.renderer.reset(new Renderer(&slot.scene, settings));
+    return true;
+}
+
+// Poses the slot's scene for frame and queues its tiles behind any already queued
+void AnimationPipeline::startFrame(FrameSlot& slot, int frame) {
+    {
+        ProfileScope scope("update scene", "frame", frame);
+        slot.scene.update(frame / animation.fps);
+        slot.renderer->beginFrame();
+    }
+    slot.frame = frame;
+    const int numTiles = slot.renderer->getNumTiles();
+    {
+        lock_guard<mutex> lock(queueMutex);
+        slot.tasksLeft = numTiles;
+        slot.finished = false;
+        for (int tile = 0; tile < numTiles; tile++) queue.push_back({ &slot, tile });
+    }
+    tilesQueued.notify_all();
+}
+
+void AnimationPipeline::waitForFrame(FrameSlot& slot) {
+    unique_lock<mutex> lock(queueMutex);
+    frameFinished.wait(lock, [&] { return slot.finished; });
+}
+
+/*
+ * Moves a slot whose tasks are all done on to its next stage, returning
+ * false once the frame is finished: the traced frame is denoised one pass at
+ * a time, every pass's bands run by the workers like the tiles were.
+ */
+static bool nextStage(FrameSlot& slot) {
+    if (!slot.renderer->getSettings().denoise) return false;
+    if (!slot.denoiser) {
+        slot.denoiser.reset(new Denoiser(slot.renderer->getFramebuffer(), slot.renderer->getAuxBuffers()));
+    } else if (!slot.denoiser->nextPass()) {
+        slot.renderer->finishDenoise(*slot.denoiser);
+        slot.denoiser.reset();
+        return false;
+    }
+    return true;
+}
+
+void AnimationPipeline::traceWorker(int worker) {
+    if (Profiler::isRunning()) Profiler::setThread(worker + 1, "worker " + to_string(worker));
+    vector<float> scratch;      // for the denoiser's bands
+    while (true) {
+        TileJob job;
+        {
+            unique_lock<mutex> lock(queueMutex);
+            tilesQueued.wait(lock, [&] { return stopping || !queue.empty(); });
+            if (queue.empty()) return;
+            job = queue.front();
+            queue.pop_front();
+        }
+        FrameSlot& slot = *job.slot;
+        if (slot.denoiser) slot.denoiser->filterBand(job.task, scratch);
+        else slot.renderer->renderTile(job.task, threadStats[worker]);
+
+        unique_lock<mutex> lock(queueMutex);
+        if (--slot.tasksLeft > 0) continue;
+        // the thread finishing a stage's last task starts the next; the frame is waited for, so its bands go
+        // ahead of the next frame's tiles
+        lock.unlock();
+        bool more = nextStage(slot);
+        lock.lock();
+        if (more) {
+            const int numBands = slot.denoiser->getNumBands();
+            slot.tasksLeft = numBands;
+            for (int band = numBands - 1; band >= 0; band--) queue.push_front({ &slot, band });
+            tilesQueued.notify_all();
+        } else {
+            slot.finished = true;
+            frameFinished.notify_all();
+        }
+    }
+}
+
+bool AnimationPipeline::run(const string& sceneName) {
+    settings.recordHeatmaps = false;    // one set of heatmaps would mix two frames' tiles
+    threadStats.assign(settings.numThreads, RayStats());
+    const int first = animation.firstFrame;
+    const int last = animation.lastFrame;
+
+    {
+        ProfileScope scope("build scene");
+        if (!buildSlot(slots[0], sceneName)) return false;
+    }
+    auto start = chrono::steady_clock::now();
+    startFrame(slots[0], first);
+    vector<thread> threads;
+    for (int i = 0; i < settings.numThreads; i++) threads.push_back(thread(&AnimationPipeline::traceWorker, this, i));
+
+    // the second copy is built while the first frame is traced; not alongside the first
+    // copy, since scenes with random placement share rand()
+    bool secondBuilt = true;
+    thread builder([&] {
+        if (first == last) return;
+        ProfileScope scope("build scene");
+        secondBuilt = buildSlot(slots[1], sceneName);
+        if (secondBuilt) startFrame(slots[1], first + 1);
+    });
+
+    bool ok = true;
+    auto previous = start;
+    for (int frame = first; frame <= last && ok; frame++) {
+        FrameSlot& slot = slots[(frame - first) % 2];
+        if (frame == first + 1) {
+            if (builder.joinable()) builder.join();
+            if (!secondBuilt) {
+                ok = false;
+                break;
+            }
+        }
+        waitForFrame(slot);
+        auto now = chrono::steady_clock::now();
+
+        char path[1024];
+        snprintf(path, sizeof(path), animation.outputPattern.c_str(), frame);
+        {
+            ProfileScope scope("write frame", "frame", frame);
+            ok = writeBMP(path, settings.width, settings.height, slot.renderer->getFramebuffer()) && ok;
+        }
+        printf("frame %d: %.1f ms -> %s\n", frame, chrono::duration<double, milli>(now - previous).count(), path);
+        fflush(stdout);
+        previous = now;
+
+        if (frame + 2 <= last) {
+            if (builder.joinable()) builder.join();     // frame + 1 is queued first
+            startFrame(slot, frame + 2);
+        }
+    }
+    if (builder.joinable()) builder.join();
+
+    {
+        lock_guard<mutex> lock(queueMutex);
+        stopping = true;
+        queue.clear();      // only left over when a frame failed to write
+    }
+    tilesQueued.notify_all();
+    RayStats stats;
+    for (int i = 0; i < settings.numThreads; i++) {
+        threads[i].join();
+        stats.add(threadStats[i]);
+    }
+
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    printf("Rendered %d frames in %.2f s (%.2f frames/s)\n", last - first + 1, seconds, (last - first + 1) / seconds);
+    if (settings.printRayDebug) stats.print();
+    return ok;
+}
+
+}
+
+bool renderAnimation(const string& sceneName, const RenderSettings& settings, const AnimationSettings& animation) {
+    if (animation.lastFrame < animation.firstFrame || animation.fps <= 0) {
+        cout << "Error :: Invalid frame range or frame rate" << endl;
+        return false;
+    }
+    unique_ptr<AnimationPipeline> pipeline(new AnimationPipeline(settings, animation));
+    return pipeline->run(sceneName);
+}
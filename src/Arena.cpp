@@ -0,0 +1,37 @@
+#include "Arena.h"
+#include <cstdint>
+#include <algorithm>
+using namespace std;
+
+void* Arena::allocate(size_t size, size_t alignment) {
+    uintptr_t aligned = ((uintptr_t)cursor + alignment - 1) & ~(uintptr_t)(alignment - 1);
+    if (cursor == nullptr || aligned + size > (uintptr_t)end) {
+        // objects bigger than a block get a block of their own
+        size_t capacity = max(blockSize, size + alignment);
+        cursor = static_cast<char*>(::operator new(capacity));
+        end = cursor + capacity;
+        blocks.push_back(cursor);
+        aligned = ((uintptr_t)cursor + alignment - 1) & ~(uintptr_t)(alignment - 1);
+    }
+    cursor = (char*)(aligned + size);
+    used += size;
+    return (void*)aligned;
+}
+
+void Arena::reset() {
+    for (size_t i = destructors.size(); i-- > 0;) destructors[i].destroy(destructors[i].object);
+    destructors.clear();
+    for (char* block : blocks) ::operator delete(block);
+    blocks.clear();
+    cursor = end = nullptr;
+    used = 0;
+}
+
+void Arena::swap(Arena& other) {
+    std::swap(blockSize, other.blockSize);
+    blocks.swap(other.blocks);
+    std::swap(cursor, other.cursor);
+    std::swap(end, other.end);
+    std::swap(used, other.used);
+    destructors.swap(other.destructors);
+}
@@ -1,6 +1,7 @@
 #include "BVH.h"
 #include "UniqueStack.h"
 #include "BVHNode.h"
+#include "Sphere.h"
 #include <glm/glm.hpp>
 #include <iostream>
 using namespace std;
@@ -8,11 +9,11 @@ using namespace std;
 BVH::BVH(std::vector<SceneObject*> *sceneObjects) : sceneObjects(sceneObjects) {
     // nodes = new BVHNode[sceneObjects->size() * 2];
 
-    head = new BVHNode(0, (*sceneObjects).size());
+    head = nodes.create<BVHNode>(0, (*sceneObjects).size());
     AABB worldBBox;
 
     worldBBox = (*sceneObjects)[0]->getBBox();
-    for (int i = 1; i < sceneObjects->size(); i++) {
+    for (size_t i = 1; i < sceneObjects->size(); i++) {
             worldBBox = unionAABB(worldBBox, (*sceneObjects)[i]->getBBox());
     }
 
@@ -31,11 +32,17 @@ void BVH::buildRecursive(BVHNode *node) {
     if(ridx - lidx <= LEAF_OBJ_THRESHOLD) {
         // if number of objects between lidx and ridx is less than or equal to LEAF_OBJ_THRESHOLD, make nodeidx a leaf node
         node->makeLeaf();
+        makeSphereBatch(node);
         // printNode(nodeidx);
         return;
+    } else if (ridx - lidx <= SPHERE_BATCH_WIDTH && makeSphereBatch(node)) {
+        // a handful of spheres is tested faster as one batch than split further
+        node->makeLeaf();
+        return;
     } else{
-        node->setLeft(new BVHNode());
-        node->setRight(new BVHNode());
+        // siblings are allocated together, next to each other in the arena
+        node->setLeft(nodes.create<BVHNode>());
+        node->setRight(nodes.create<BVHNode>());
     }
 
     // find largest axis for node's bounding box
@@ -74,10 +81,10 @@ void BVH::buildRecursive(BVHNode *node) {
     // calculate bounding box for left and right splits
     AABB leftBBox = (*sceneObjects)[lidx]->getBBox();
     AABB rightBBox = (*sceneObjects)[mid]->getBBox();
-    for (int i = lidx + 1; i < mid; i++) {
+    for (unsigned int i = lidx + 1; i < mid; i++) {
         leftBBox = unionAABB(leftBBox, (*sceneObjects)[i]->getBBox());
     }
-    for (int i = mid + 1; i < ridx; i++) {
+    for (unsigned int i = mid + 1; i < ridx; i++) {
         rightBBox = unionAABB(rightBBox, (*sceneObjects)[i]->getBBox());
     }
 
@@ -97,23 +104,24 @@ void BVH::buildRecursive(BVHNode *node) {
     buildRecursive(node->getRight());
 }
 
-struct RayHit BVH::intersect(glm::vec3 p0, glm::vec3 dir) {
+int BVH::intersect(Ray& ray, int *nodeVisits) {
     UniqueStack<BVHNode*> stack; // stack of node indices to check collision for
     stack.push(head);
 
-    struct RayHit hit;
-
+    const glm::vec3& p0 = ray.p0;
+    const glm::vec3& dir = ray.dir;
+    int numNodeVisits = 0;
     int numIntersections = 0;
     while (!stack.empty()) {
         // cout << "Stack size: " << stack.size() << endl;
         BVHNode* node = stack.pop();
 
-        float bboxIntersection = node->getBBox().intersect(p0, dir);
-        numIntersections++;
+        float bboxIntersection = node->getBBox().entryDistance(p0, dir);
+        numNodeVisits++;
 
         // if the ray does not intersect the current node's bounding box, skip the node
-        // or if closestHit is closer than the current node's bounding box, skip the node
-        if((bboxIntersection < 0) || (hit.dist >= 0 && bboxIntersection > hit.dist)){
+        // or if the box starts beyond the closest hit so far (tMax), skip the node
+        if((bboxIntersection < 0) || (bboxIntersection > ray.tMax)){
             continue;
         }
 
@@ -125,22 +133,75 @@ struct RayHit BVH::intersect(glm::vec3 p0, glm::vec3 dir) {
         }
 
         // if the node is a leaf node, check for intersection with each object in the node
-        float tmin = 1.e+6;
+        // and keep the hit if it is closer than any found in earlier leaves
+        if (node->getBatch() >= 0) {
+            const SphereBatch& batch = sphereBatches[node->getBatch()];
+            float t;
+            int lane = batch.intersect(p0, dir, ray.tMin, ray.tMax, t);
+            numIntersections += batch.count;
+            if (lane >= 0) {
+                ray.hit.t = t;
+                ray.hit.primID = batch.primID[lane];
+                ray.hit.u = ray.hit.v = 0;
+                ray.tMax = t;
+            }
+            continue;
+        }
         for (size_t i = node->getIndex(); i < node->getIndex() + node->getNumObjects(); i++) {
-            float t = (*sceneObjects)[i]->intersect(p0, dir);
+            glm::vec2 uv(0.0f);
+            float t = (*sceneObjects)[i]->intersectUV(p0, dir, uv);
             numIntersections++;
-            if (t > 0 && t < tmin) {
-                tmin = t;
-                hit.dist = t;
-                hit.objIdx = i;
-                hit.hit = p0 + dir * t;
+            if (t > ray.tMin && t < ray.tMax) {
+                ray.hit.t = t;
+                ray.hit.primID = i;
+                ray.hit.u = uv.x;
+                ray.hit.v = uv.y;
+                ray.tMax = t;
             }
         }
     }
 
-    hit.numIntersections = numIntersections;
-    
-    return hit;
+    if (nodeVisits != nullptr) *nodeVisits = numNodeVisits;
+    return numIntersections;
+}
+
+void BVH::refit() {
+    refitNode(head);
+}
+
+// Leaves bound their objects and internal nodes their children, from the leaves up
+AABB BVH::refitNode(BVHNode *node) {
+    AABB bbox;
+    if (node->isLeaf()) {
+        unsigned int first = node->getIndex();
+        bbox = (*sceneObjects)[first]->getBBox();
+        for (unsigned int i = first + 1; i < first + node->getNumObjects(); i++) {
+            bbox = unionAABB(bbox, (*sceneObjects)[i]->getBBox());
+        }
+        if (node->getBatch() >= 0) {
+            SphereBatch& batch = sphereBatches[node->getBatch()];
+            for (int lane = 0; lane < batch.count; lane++) {
+                batch.set(lane, *dynamic_cast<Sphere*>((*sceneObjects)[batch.primID[lane]]));
+            }
+        }
+    } else {
+        bbox = unionAABB(refitNode(node->getLeft()), refitNode(node->getRight()));
+    }
+    node->setAABB(bbox);
+    return bbox;
+}
+
+// Gives a node whose objects are all spheres a batch of them, returns false if any is not a sphere
+bool BVH::makeSphereBatch(BVHNode *node) {
+    SphereBatch batch;
+    for (unsigned int i = node->getIndex(); i < node->getIndex() + node->getNumObjects(); i++) {
+        Sphere *sphere = dynamic_cast<Sphere*>((*sceneObjects)[i]);
+        if (sphere == nullptr) return false;
+        batch.add(*sphere, i);
+    }
+    node->setBatch(sphereBatches.size());
+    sphereBatches.push_back(batch);
+    return true;
 }
 
 AABB BVH::unionAABB(const AABB &a, const AABB &b) {
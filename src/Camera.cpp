@@ -0,0 +1,93 @@
+#include "Camera.h"
+#include <cmath>
+
+void Camera::lookAt(glm::vec3 eye, glm::vec3 target, glm::vec3 up) {
+    this->eye = eye;
+    forward = glm::normalize(target - eye);
+    right = glm::normalize(glm::cross(forward, up));
+    this->up = glm::cross(right, forward);
+}
+
+void Camera::setFov(float degrees) {
+    tanHalfFov = tan(degrees * M_PI / 360.0);
+}
+
+float Camera::getFov() const {
+    return atan(tanHalfFov) * 360.0 / M_PI;
+}
+
+void Camera::setResolution(int width, int height) {
+    this->width = width;
+    this->height = height;
+}
+
+// Maps a point of the unit square onto the unit disk, keeping strata intact (Shirley and Chiu)
+static glm::vec2 concentricDisk(float u, float v) {
+    float a = 2.0f * u - 1.0f;
+    float b = 2.0f * v - 1.0f;
+    if (a == 0.0f && b == 0.0f) return glm::vec2(0.0f);
+    float r, phi;
+    if (fabs(a) > fabs(b)) {
+        r = a;
+        phi = (M_PI / 4.0) * (b / a);
+    } else {
+        r = b;
+        phi = (M_PI / 2.0) - (M_PI / 4.0) * (a / b);
+    }
+    return glm::vec2(r * cos(phi), r * sin(phi));
+}
+
+/*
+ * The image plane is one unit in front of the eye. With a lens the ray starts
+ * from a point on the lens and passes through the point the pinhole ray hits
+ * on the plane in focus. The ray differentials are the pinhole camera's.
+ */
+Ray Camera::generateRay(float x, float y, float lensU, float lensV, RayDifferential& diff) const {
+    const float cell = 2.0f * tanHalfFov / height;
+    const float halfWidth = tanHalfFov * width / height;
+    glm::vec3 dx = right * cell;
+    glm::vec3 dy = up * cell;
+    glm::vec3 dir = forward + right * (x * cell - halfWidth) + up * (y * cell - tanHalfFov);
+
+    Ray ray;
+    if (aperture > 0.0f) {
+        glm::vec3 focus = eye + dir * focusDistance;    // dir is one unit along forward
+        glm::vec2 lens = concentricDisk(lensU, lensV) * aperture;
+        glm::vec3 origin = eye + right * lens.x + up * lens.y;
+        ray = Ray(origin, focus - origin);
+    } else {
+        ray = Ray(eye, dir);
+    }
+    diff = RayDifferential::primary(dir, dx, dy);
+    return ray;
+}
+
+void CameraPath::addKey(float time, glm::vec3 eye, glm::vec3 target) {
+    keys.push_back({ time, eye, target });
+}
+
+static glm::vec3 catmullRom(glm::vec3 p0, glm::vec3 p1, glm::vec3 p2, glm::vec3 p3, float u) {
+    return 0.5f * (2.0f * p1 + (p2 - p0) * u + (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) * (u * u) +
+                   (3.0f * p1 - p0 - 3.0f * p2 + p3) * (u * u * u));
+}
+
+void CameraPath::apply(Camera& camera, float time) const {
+    if (keys.empty()) return;
+    if (time <= keys.front().time || keys.size() == 1) {
+        camera.lookAt(keys.front().eye, keys.front().target);
+        return;
+    }
+    if (time >= keys.back().time) {
+        camera.lookAt(keys.back().eye, keys.back().target);
+        return;
+    }
+
+    size_t i = 0;
+    while (keys[i + 1].time <= time) i++;
+    const Key& k0 = keys[i > 0 ? i - 1 : i];     // the end keys stand in for their missing neighbours
+    const Key& k1 = keys[i];
+    const Key& k2 = keys[i + 1];
+    const Key& k3 = keys[i + 2 < keys.size() ? i + 2 : i + 1];
+    float u = (time - k1.time) / (k2.time - k1.time);
+    camera.lookAt(catmullRom(k0.eye, k1.eye, k2.eye, k3.eye, u), catmullRom(k0.target, k1.target, k2.target, k3.target, u));
+}
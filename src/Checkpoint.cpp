@@ -0,0 +1,204 @@
+#include "Checkpoint.h"
+#include <csignal>
+#include <cstdio>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include "Scene.h"
+#include "Config.h"
+#include "Random.h"
+#include "TextureCache.h"
+using namespace std;
+
+const uint32_t CHECKPOINT_VERSION = 1;
+
+void Accumulation::reset(int width, int height) {
+    this->width = width;
+    this->height = height;
+    passes = 0;
+    size_t n = (size_t)width * height;
+    sum.assign(n, glm::vec3(0));
+    samples.assign(n, 0);
+    rngState.resize(n);
+    for (size_t i = 0; i < n; i++) rngState[i] = Random(i).getState();
+}
+
+/*
+ * A checkpoint is "RTCK", then the version, width, height, passes and the
+ * length of the job description as little-endian int32, the job description,
+ * and then the sums (3 float32 per cell), sample counts (uint32) and
+ * generator states (uint64) in framebuffer order.
+ */
+bool writeCheckpoint(const string& path, const string& job, const Accumulation& accumulation) {
+    const string tempPath = path + ".tmp";
+    {
+        ofstream out(tempPath, ios::binary);
+        if (!out) {
+            cout << "Error :: Unable to open " << tempPath << endl;
+            return false;
+        }
+        int32_t header[5] = { (int32_t)CHECKPOINT_VERSION, accumulation.width, accumulation.height,
+                              accumulation.passes, (int32_t)job.size() };
+        out.write("RTCK", 4);
+        out.write((const char*)header, sizeof(header));
+        out.write(job.data(), job.size());
+        out.write((const char*)accumulation.sum.data(), accumulation.sum.size() * sizeof(glm::vec3));
+        out.write((const char*)accumulation.samples.data(), accumulation.samples.size() * sizeof(uint32_t));
+        out.write((const char*)accumulation.rngState.data(), accumulation.rngState.size() * sizeof(uint64_t));
+        out.flush();
+        if (!out) {
+            cout << "Error :: Unable to write " << tempPath << endl;
+            return false;
+        }
+    }
+    if (rename(tempPath.c_str(), path.c_str()) != 0) {
+        cout << "Error :: Unable to replace " << path << endl;
+        return false;
+    }
+    return true;
+}
+
+bool readCheckpoint(const string& path, string& job, Accumulation& accumulation) {
+    ifstream in(path, ios::binary);
+    if (!in) {
+        cout << "Error :: Unable to open checkpoint " << path << endl;
+        return false;
+    }
+    char magic[4];
+    int32_t header[5];
+    in.read(magic, 4);
+    in.read((char*)header, sizeof(header));
+    const int32_t width = header[1], height = header[2], jobSize = header[4];
+    if (!in || string(magic, 4) != "RTCK" || header[0] != (int32_t)CHECKPOINT_VERSION || width <= 0 || height <= 0 ||
+        jobSize < 0 || jobSize > (1 << 20)) {
+        cout << "Error :: " << path << " is not a checkpoint" << endl;
+        return false;
+    }
+    job.resize(jobSize);
+    in.read(&job[0], jobSize);
+
+    // the arrays must fill the rest of the file, checked before a corrupt header can ask for any size of them
+    const streampos arraysStart = in.tellg();
+    in.seekg(0, ios::end);
+    const int64_t arraysSize = (int64_t)(in.tellg() - arraysStart);
+    const int64_t expectedSize = (int64_t)width * height * (sizeof(glm::vec3) + sizeof(uint32_t) + sizeof(uint64_t));
+    if (!in || arraysSize != expectedSize) {
+        cout << "Error :: " << path << " is not a checkpoint" << endl;
+        return false;
+    }
+    in.seekg(arraysStart);
+
+    accumulation.reset(width, height);
+    accumulation.passes = header[3];
+    in.read((char*)accumulation.sum.data(), accumulation.sum.size() * sizeof(glm::vec3));
+    in.read((char*)accumulation.samples.data(), accumulation.samples.size() * sizeof(uint32_t));
+    in.read((char*)accumulation.rngState.data(), accumulation.rngState.size() * sizeof(uint64_t));
+    if (!in) {
+        cout << "Error :: " << path << " is truncated" << endl;
+        return false;
+    }
+    return true;
+}
+
+bool CheckpointWriter::write(const string& path, const string& job, const Accumulation& accumulation) {
+    if (busy) return false;
+    if (thread.joinable()) thread.join();
+    snapshot = accumulation;
+    busy = true;
+    thread = std::thread([this, path, job] {
+        if (!writeCheckpoint(path, job, snapshot)) failed = true;
+        busy = false;
+    });
+    return true;
+}
+
+bool CheckpointWriter::finish() {
+    if (thread.joinable()) thread.join();
+    return !failed;
+}
+
+//---Progressive rendering -----------------------------------------------------------
+
+static volatile sig_atomic_t stopRequested = 0;
+
+static void requestStop(int) {
+    stopRequested = 1;
+}
+
+bool renderProgressive(const string& sceneName, const RenderSettings& settings, const ProgressiveSettings& progressive,
+                       vector<glm::vec3>& image) {
+    // the job is everything that changes the samples, so not the number of threads or denoising
+    RenderSettings jobSettings = settings;
+    jobSettings.numThreads = 1;
+    jobSettings.denoise = false;
+    jobSettings.printRayDebug = false;
+    ostringstream jobText;
+    jobText << sceneName << "\n";
+    writeSettings(jobText, jobSettings);
+    const string job = jobText.str();
+    const string& path = progressive.checkpointPath;
+
+    Accumulation accumulation;
+    if (progressive.resume) {
+        string savedJob;
+        if (!readCheckpoint(path, savedJob, accumulation)) return false;
+        if (savedJob != job) {
+            cout << "Error :: " << path << " is a checkpoint of a different scene or settings" << endl;
+            return false;
+        }
+        cout << "Resuming from pass " << accumulation.passes << " of " << path << endl;
+    } else {
+        accumulation.reset(settings.width, settings.height);
+    }
+
+    Scene scene;
+    TextureCache textureCache;
+    if (!buildScene(sceneName, scene, textureCache)) return false;
+    scene.build();
+    Renderer renderer(&scene, settings);
+
+    stopRequested = 0;
+    signal(SIGINT, requestStop);
+    signal(SIGTERM, requestStop);
+
+    CheckpointWriter writer;
+    const int firstPass = accumulation.passes;
+    auto lastCheckpoint = chrono::steady_clock::now();
+    while (accumulation.passes < progressive.passes && !stopRequested) {
+        auto start = chrono::steady_clock::now();
+        renderer.renderPass(accumulation);
+        auto now = chrono::steady_clock::now();
+        printf("pass %d/%d: %.1f ms\n", accumulation.passes, progressive.passes,
+               chrono::duration<double, milli>(now - start).count());
+        fflush(stdout);
+
+        bool due = chrono::duration<double>(now - lastCheckpoint).count() >= progressive.checkpointInterval;
+        if (!path.empty() && due && accumulation.passes < progressive.passes) {
+            if (writer.write(path, job, accumulation)) lastCheckpoint = now;
+        }
+    }
+
+    signal(SIGINT, SIG_DFL);
+    signal(SIGTERM, SIG_DFL);
+
+    // the last checkpoint is written in full before returning, finished or not
+    bool ok = writer.finish();
+    if (!path.empty()) ok = writeCheckpoint(path, job, accumulation) && ok;
+
+    // denoising needs the aux buffers traced along with a pass in this process
+    if (settings.denoise && accumulation.passes > firstPass) {
+        renderer.denoise();
+        image = renderer.getFramebuffer();
+    } else {
+        image.resize(accumulation.sum.size());
+        for (size_t i = 0; i < image.size(); i++) image[i] = accumulation.mean(i);
+    }
+    if (stopRequested) {
+        cout << "Stopped after pass " << accumulation.passes << " of " << progressive.passes;
+        if (!path.empty()) cout << ", resume with --resume";
+        cout << endl;
+        return false;
+    }
+    return ok;
+}
@@ -1,72 +1,71 @@
 #include "Cone.h"
+#include <cmath>
+#include <algorithm>
 
-float Cone::intersect(glm::vec3 p0, glm::vec3 dir) {
-    // if(aabb_.intersect(p0, dir) == -1.0) return -1.0;
-    dir = normalize(dir);
-
-    float tanThetaSq = (radius / height) * (radius / height);
-    glm::vec3 d = p0 - center;
-    float a = dir.x * dir.x + dir.z * dir.z - dir.y * dir.y * tanThetaSq;
-    float b = 2 * (dir.x * d.x + dir.z * d.z - dir.y * d.y * tanThetaSq);
-    float c = d.x * d.x + d.z * d.z - d.y * d.y * tanThetaSq;
-    float disc = b * b - 4 * a * c;
-
-    if (disc < 1e-6) return -1.0;
-
-    float t0 = (-b - sqrt(disc)) / (2 * a);
-    float t1 = (-b + sqrt(disc)) / (2 * a);
+void Cone::precompute() {
+    radiusSq = radius * radius;
+    slopeSq = (radius / height) * (radius / height);
+    cosHalfAngle = height / sqrtf(height * height + radiusSq);
+}
 
-    if (t0 > t1) std::swap(t0, t1);
+/*
+ * dir is a unit vector. With d the ray origin relative to the apex and h the
+ * axial part of a point, the cone's surface is |p|^2 = (1 + slope^2) h^2, a
+ * quadratic in t whose roots are kept when they lie between the apex and
+ * the base. The base cap is one test, which fails on its own for rays
+ * parallel to it.
+ */
+float Cone::intersect(const glm::vec3& p0, const glm::vec3& dir) {
+    float tNear, tFar;
+    if (!aabb_.interval(p0, dir, tNear, tFar)) return -1.0;
 
-    if (dir.y > 1e-6) {
-        // Base Cap
-        glm::vec3 cap_center = center - glm::vec3(0, height, 0);
-        float t = (cap_center.y - p0.y) / dir.y;
-        glm::vec3 p = p0 + t * dir;
-        if (t > 0 && glm::distance(glm::vec2(p.x, p.z), glm::vec2(cap_center.x, cap_center.z)) <= radius) {
-            return t;
+    glm::vec3 d = p0 - center;
+    float dirAxial = glm::dot(dir, axis);
+    float originAxial = glm::dot(d, axis);
+    float k = 1 + slopeSq;
+    float best = INFINITY;
+
+    float a = 1 - k * dirAxial * dirAxial;
+    float b = glm::dot(dir, d) - k * dirAxial * originAxial;
+    float c = glm::dot(d, d) - k * originAxial * originAxial;
+    float disc = b * b - a * c;
+    if (disc >= 0) {
+        // stable roots, a = 0 (parallel to the surface) leaves the finite one
+        float q = -b - copysignf(sqrtf(disc), b);
+        float roots[2] = { q / a, c / q };
+        for (float t : roots) {
+            float h = originAxial + t * dirAxial;
+            if (t > 0 && t < best && h <= 0 && h >= -height) best = t;
         }
     }
 
-    if (t0 > 0) {
-        glm::vec3 p = p0 + t0 * dir;
-        if (p.y <= center.y && p.y >= center.y - height) {
-            return t0;
-        }
-    }
+    // Base cap
+    float tCap = (-height - originAxial) / dirAxial;
+    glm::vec3 p = d + tCap * dir;
+    if (tCap > 0 && tCap < best && glm::dot(p, p) - height * height <= radiusSq) best = tCap;
 
-    if (t1 > 0) {
-        glm::vec3 p = p0 + t1 * dir;
-        if (p.y <= center.y && p.y >= center.y - height) {
-            return t1;
-        }
-    }
-
-    return -1.0;
+    return (best < INFINITY) ? best : -1.0;
 }
 
-glm::vec3 Cone::normal(glm::vec3 p) {
-    float epsilon = 1e-6;
+glm::vec3 Cone::normal(const glm::vec3& p) {
+    glm::vec3 d = p - center;
+    float h = glm::dot(d, axis);
+    glm::vec3 radial = d - h * axis;
 
-    // Check if the point is on the top cap
-    if (fabs(p.y - center.y) < epsilon) {
-        return glm::vec3(0, -1, 0);
+    // Check whether the point is nearer the base than the side
+    float toBase = fabs(h + height);
+    float toSide = fabs(-h * radius / height - glm::length(radial)) * cosHalfAngle;
+    if (toBase < toSide) {
+        return -axis;
     }
 
-    glm::vec3 cp = p - center;
-    float r = sqrt(cp.x * cp.x + cp.z * cp.z);
-    glm::vec3 n = glm::vec3(cp.x, r * (radius / height), cp.z);
-
-    return glm::normalize(n);
+    // Gradient of |d|^2 - (1 + slope^2) h^2
+    return glm::normalize(d - (1 + slopeSq) * h * axis);
 }
 
-
-    
-
-
-    
-
+// The apex and the base disc, which spans radius * sqrt(1 - axis[i]^2) along world axis i
 void Cone::calculateAABB() {
-    aabb_ = AABB(glm::vec3(center.x - radius, center.y, center.z - radius), 
-    glm::vec3(center.x + radius, center.y + height, center.z + radius));
-}
\ No newline at end of file
+    glm::vec3 extent = radius * glm::sqrt(glm::max(glm::vec3(1.0f) - axis * axis, glm::vec3(0.0f)));
+    glm::vec3 base = center - height * axis;
+    aabb_ = AABB(glm::min(center, base - extent), glm::max(center, base + extent));
+}
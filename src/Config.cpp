@@ -0,0 +1,202 @@
+#include "Config.h"
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <iostream>
+using namespace std;
+
+static bool parseInt(const string& value, int minValue, int maxValue, int& out) {
+    istringstream in(value);
+    int v;
+    if (!(in >> v) || !in.eof() || v < minValue || v > maxValue) return false;
+    out = v;
+    return true;
+}
+
+static bool parseFloat(const string& value, float& out) {
+    istringstream in(value);
+    float v;
+    if (!(in >> v) || !in.eof() || v <= 0) return false;
+    out = v;
+    return true;
+}
+
+static bool parseVec3(const string& value, glm::vec3& out) {
+    istringstream in(value);
+    glm::vec3 v;
+    char comma1, comma2;
+    if (!(in >> v.x >> comma1 >> v.y >> comma2 >> v.z) || !in.eof() || comma1 != ',' || comma2 != ',') return false;
+    out = v;
+    return true;
+}
+
+static bool parseBool(const string& value, bool& out) {
+    if (value == "on" || value == "true" || value == "1") out = true;
+    else if (value == "off" || value == "false" || value == "0") out = false;
+    else return false;
+    return true;
+}
+
+bool applySetting(const string& name, const string& value, RenderSettings& settings) {
+    const int MAX_SIZE = 16384;
+    bool ok = false;
+    bool known = true;
+    if (name == "width") {
+        ok = parseInt(value, 1, MAX_SIZE, settings.width);
+    } else if (name == "height") {
+        ok = parseInt(value, 1, MAX_SIZE, settings.height);
+    } else if (name == "size") {
+        ok = parseInt(value, 1, MAX_SIZE, settings.width);
+        settings.height = settings.width;
+    } else if (name == "resolution") {
+        size_t x = value.find('x');
+        ok = x != string::npos &&
+             parseInt(value.substr(0, x), 1, MAX_SIZE, settings.width) &&
+             parseInt(value.substr(x + 1), 1, MAX_SIZE, settings.height);
+    } else if (name == "threads") {
+        ok = parseInt(value, 1, 1024, settings.numThreads);
+    } else if (name == "max-depth") {
+        ok = parseInt(value, 1, 1000, settings.maxSteps);
+    } else if (name == "split-depth") {
+        ok = parseInt(value, 0, 1000, settings.splitDepth);
+    } else if (name == "aa") {
+        ok = parseBool(value, settings.enableAA);
+    } else if (name == "aa-samples") {
+        ok = parseInt(value, 1, 16, settings.aaSamples);
+    } else if (name == "accel") {
+        ok = value == "bvh" || value == "linear";
+        if (ok) settings.enableBVH = value == "bvh";
+    } else if (name == "integrator") {
+        ok = value == "whitted" || value == "path";
+        if (ok) settings.pathTrace = value == "path";
+    } else if (name == "fov") {
+        ok = parseFloat(value, settings.fov) && settings.fov < 180;
+    } else if (name == "aperture") {
+        istringstream in(value);
+        float v;
+        ok = (in >> v) && in.eof() && v >= 0;
+        if (ok) settings.aperture = v;
+    } else if (name == "focus-distance") {
+        ok = parseFloat(value, settings.focusDistance);
+    } else if (name == "eye") {
+        ok = parseVec3(value, settings.eye);
+        if (ok) settings.overrideEye = true;
+    } else if (name == "look-at") {
+        ok = parseVec3(value, settings.lookAt);
+        if (ok) settings.overrideLookAt = true;
+    } else if (name == "denoise") {
+        ok = parseBool(value, settings.denoise);
+    } else if (name == "ray-debug") {
+        ok = parseBool(value, settings.printRayDebug);
+    } else {
+        known = false;
+    }
+
+    if (!known) cout << "Error :: Unknown setting '" << name << "'" << endl;
+    else if (!ok) cout << "Error :: Invalid value '" << value << "' for " << name << endl;
+    return ok;
+}
+
+bool loadConfigFile(const string& path, RenderSettings& settings) {
+    ifstream in(path);
+    if (!in) {
+        cout << "Error :: Unable to open config file " << path << endl;
+        return false;
+    }
+    return parseConfig(in, path, settings);
+}
+
+bool parseConfig(istream& in, const string& source, RenderSettings& settings) {
+    string line;
+    int lineNumber = 0;
+    while (getline(in, line)) {
+        lineNumber++;
+        line = line.substr(0, line.find('#'));
+        size_t eq = line.find('=');
+        istringstream nameIn(line.substr(0, eq));
+        string name, value;
+        if (!(nameIn >> name)) continue;    // blank or comment
+        if (eq != string::npos) {
+            istringstream valueIn(line.substr(eq + 1));
+            valueIn >> value;
+        }
+        if (eq == string::npos || value.empty() || !applySetting(name, value, settings)) {
+            cout << "Error :: " << source << ":" << lineNumber << ": expected 'name = value'" << endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+ * Floats are written with enough digits to read back exactly, so another
+ * process given these settings renders the same image.
+ */
+void writeSettings(ostream& out, const RenderSettings& settings) {
+    out << setprecision(9);
+    out << "resolution = " << settings.width << "x" << settings.height << "\n";
+    out << "threads = " << settings.numThreads << "\n";
+    out << "max-depth = " << settings.maxSteps << "\n";
+    out << "split-depth = " << settings.splitDepth << "\n";
+    out << "aa = " << (settings.enableAA ? "on" : "off") << "\n";
+    out << "aa-samples = " << settings.aaSamples << "\n";
+    out << "accel = " << (settings.enableBVH ? "bvh" : "linear") << "\n";
+    out << "integrator = " << (settings.pathTrace ? "path" : "whitted") << "\n";
+    out << "denoise = " << (settings.denoise ? "on" : "off") << "\n";
+    if (settings.fov > 0) out << "fov = " << settings.fov << "\n";
+    if (settings.aperture >= 0) out << "aperture = " << settings.aperture << "\n";
+    if (settings.focusDistance > 0) out << "focus-distance = " << settings.focusDistance << "\n";
+    const glm::vec3& eye = settings.eye;
+    const glm::vec3& lookAt = settings.lookAt;
+    if (settings.overrideEye) out << "eye = " << eye.x << "," << eye.y << "," << eye.z << "\n";
+    if (settings.overrideLookAt) out << "look-at = " << lookAt.x << "," << lookAt.y << "," << lookAt.z << "\n";
+    out << "ray-debug = " << (settings.printRayDebug ? "on" : "off") << "\n";
+}
+
+bool parseSettings(int argc, char *argv[], RenderSettings& settings, vector<string>& unparsed) {
+    static const char* names[] = { "width", "height", "size", "resolution", "threads", "max-depth", "split-depth",
+                                   "aa", "aa-samples", "accel", "integrator", "denoise", "fov", "aperture", "focus-distance",
+                                   "eye", "look-at", "ray-debug" };
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        bool isSetting = arg == "--config";
+        for (const char* name : names) {
+            if (arg == string("--") + name) isSetting = true;
+        }
+        if (!isSetting) {
+            unparsed.push_back(arg);
+            continue;
+        }
+        if (i + 1 >= argc) {
+            cout << "Error :: " << arg << " needs a value" << endl;
+            return false;
+        }
+        string value = argv[++i];
+        bool ok = (arg == "--config") ? loadConfigFile(value, settings) : applySetting(arg.substr(2), value, settings);
+        if (!ok) return false;
+    }
+    return true;
+}
+
+void printSettingsUsage() {
+    cout << "Render settings (also accepted in a --config file as 'name = value'):" << endl;
+    cout << "  --config FILE        read settings from FILE, later flags override it" << endl;
+    cout << "  --width N            cells across the image" << endl;
+    cout << "  --height N           cells up the image" << endl;
+    cout << "  --size N             square image of N x N cells" << endl;
+    cout << "  --resolution WxH     image of W x H cells" << endl;
+    cout << "  --threads N          worker threads" << endl;
+    cout << "  --max-depth N        maximum bounces per primary ray" << endl;
+    cout << "  --split-depth N      depth to which glass traces both reflection and refraction, one beyond" << endl;
+    cout << "  --aa on|off          anti-aliasing" << endl;
+    cout << "  --aa-samples N       anti-aliasing grid of N x N samples per cell" << endl;
+    cout << "  --accel bvh|linear   BVH traversal or testing every object" << endl;
+    cout << "  --integrator whitted|path  Whitted ray tracing, or path tracing with global illumination" << endl;
+    cout << "  --denoise on|off     filter the noise out of each frame, for renders of few samples" << endl;
+    cout << "  --fov DEGREES        vertical field of view, overriding the scene camera's" << endl;
+    cout << "  --aperture R         lens radius for depth of field, 0 for a pinhole camera" << endl;
+    cout << "  --focus-distance D   distance to the plane in focus" << endl;
+    cout << "  --eye X,Y,Z          camera position, overriding the scene camera's" << endl;
+    cout << "  --look-at X,Y,Z      point the camera looks at, overriding the scene camera's" << endl;
+    cout << "  --ray-debug on|off   print ray statistics after each frame" << endl;
+}
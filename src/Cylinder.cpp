@@ -1,74 +1,83 @@
 #include "Cylinder.h"
+#include <cmath>
+#include <algorithm>
 
-float Cylinder::intersect(glm::vec3 p0, glm::vec3 dir) {
-    // if (aabb_.intersect(p0, dir) == -1.0) return -1.0;  // No intersection if ray does not intersect AABB
+/*
+ * dir is a unit vector. The cylinder is the overlap of the slab between its
+ * caps and the infinite cylinder around its axis, so the ray's interval in
+ * each is found and the two intersected: where it enters the overlap is the
+ * hit, or where it leaves when it starts inside. A cap is hit when the slab
+ * interval is the tighter one, without testing the caps separately.
+ */
+float Cylinder::intersect(const glm::vec3& p0, const glm::vec3& dir) {
+    float tNear, tFar;
+    if (!aabb_.interval(p0, dir, tNear, tFar)) return -1.0;  // No intersection if ray does not intersect AABB
 
     glm::vec3 d = p0 - center;
-    float a = dir.x * dir.x + dir.z * dir.z;
-    float b = 2 * (dir.x * d.x + dir.z * d.z);
-    float c = d.x * d.x + d.z * d.z - radius * radius;
-    float disc = b * b - 4 * a * c;
+    float dirAxial = glm::dot(dir, axis);
+    float originAxial = glm::dot(d, axis);
 
-    if (disc < 0) return -1.0;  // No intersection if discriminant is less than 0
-
-    float t0 = (-b - sqrt(disc)) / (2 * a);
-    float t1 = (-b + sqrt(disc)) / (2 * a);
-
-    if (t0 > t1) std::swap(t0, t1);
-
-    if (dir.y > 0) {
-        // Bottom cap
-        float tBottom = (center.y - p0.y) / dir.y;
-        glm::vec3 pBottom = p0 + tBottom * dir;
-        if (tBottom > 0 && (pBottom.x - center.x) * (pBottom.x - center.x) + (pBottom.z - center.z) * (pBottom.z - center.z) <= radius * radius) {
-            return tBottom;
-        }
-    } else if (dir.y < 0) {
-        // Top cap
-        float tTop = (center.y + height - p0.y) / dir.y;
-        glm::vec3 pTop = p0 + tTop * dir;
-        if (tTop > 0 && (pTop.x - center.x) * (pTop.x - center.x) + (pTop.z - center.z) * (pTop.z - center.z) <= radius * radius) {
-            return tTop;
-        }
-    }
-
-    // Check intersection with cylinder caps
-    if (t0 > 0) {
-        glm::vec3 p = p0 + t0 * dir;
-        if (p.y >= center.y && p.y <= center.y + height) {
-            return t0;
-        }
+    // Slab between the caps, 0 <= h <= height along the axis
+    if (dirAxial == 0) {
+        if (originAxial < 0 || originAxial > height) return -1.0;
+        tNear = -INFINITY;
+        tFar = INFINITY;
+    } else {
+        float tCap0 = -originAxial / dirAxial;
+        float tCap1 = (height - originAxial) / dirAxial;
+        tNear = std::min(tCap0, tCap1);
+        tFar = std::max(tCap0, tCap1);
     }
 
-    if (t1 > 0) {
-        glm::vec3 p = p0 + t1 * dir;
-        if (p.y >= center.y && p.y <= center.y + height) {
-            return t1;
-        }
+    // Infinite cylinder, a t^2 + 2 b t + c <= 0 with the axial parts removed
+    float a = 1 - dirAxial * dirAxial;
+    float b = glm::dot(dir, d) - dirAxial * originAxial;
+    float c = glm::dot(d, d) - originAxial * originAxial - radiusSq;
+    if (a > 1.e-8) {
+        float disc = b * b - a * c;
+        if (disc < 0) return -1.0;  // No intersection if discriminant is less than 0
+        float q = -b - copysignf(sqrtf(disc), b);
+        float t0 = q / a, t1 = c / q;
+        tNear = std::max(tNear, std::min(t0, t1));
+        tFar = std::min(tFar, std::max(t0, t1));
+    } else if (c > 0) {
+        return -1.0;    // Parallel to the axis, outside the side
     }
 
-    // If no valid intersection, return -1
-    return -1.0;
+    if (tNear > tFar) return -1.0;
+    if (tNear > 0) return tNear;
+    return (tFar > 0) ? tFar : -1.0;
 }
 
-glm::vec3 Cylinder::normal(glm::vec3 p) {
-    float epsilon = 1e-6; // Small value to handle floating-point precision issues
+/*
+ * Whichever of the side and the two caps p is closest to, so points
+ * on or near the rim get the normal of the surface they were found on.
+ */
+glm::vec3 Cylinder::normal(const glm::vec3& p) {
+    glm::vec3 d = p - center;
+    float h = glm::dot(d, axis);
+    glm::vec3 radial = d - h * axis;
+    float toSide = fabs(radius - glm::length(radial));
+    float toBottom = fabs(h), toTop = fabs(height - h);
 
-    // Check if the point is on the top or bottom cap
-    if (fabs(p.y - (center.y + height)) < epsilon) {
-        // Top cap normal
-        return glm::vec3(0, 1, 0);
-    } else if (fabs(p.y - center.y) < epsilon) {
+    if (toBottom < toSide && toBottom < toTop) {
         // Bottom cap normal
-        return glm::vec3(0, -1, 0);
+        return -axis;
+    } else if (toTop < toSide) {
+        // Top cap normal
+        return axis;
     } else {
         // Side surface normal
-        glm::vec3 n = p - center;
-        n.y = 0;
-        return glm::normalize(n);
+        return glm::normalize(radial);
     }
 }
 
+/*
+ * Each cap is a disc, which spans radius * sqrt(1 - axis[i]^2) either side
+ * of its centre along world axis i.
+ */
 void Cylinder::calculateAABB() {
-    aabb_ = AABB(center - glm::vec3(radius, 0, radius), center + glm::vec3(radius, height, radius));
-}
\ No newline at end of file
+    glm::vec3 extent = radius * glm::sqrt(glm::max(glm::vec3(1.0f) - axis * axis, glm::vec3(0.0f)));
+    glm::vec3 top = center + height * axis;
+    aabb_ = AABB(glm::min(center, top) - extent, glm::max(center, top) + extent);
+}
@@ -0,0 +1,187 @@
+#include "Denoiser.h"
+#include <cmath>
+#include <atomic>
+#include <thread>
+#include <limits>
+#include <algorithm>
+#include "Profiler.h"
+using namespace std;
+
+// Each of these is the difference at which a tap keeps 1/e of its weight
+const float COLOR_SIGMA = 4.0f;      //In lighting, on the first iteration; it halves on each after
+const float NORMAL_SIGMA = 0.02f;    //In 1 - cos of the angle between unit normals, about 11 degrees
+const float DEPTH_SIGMA = 1.0f;      //In depth, as a multiple of how fast the centre's depth changes per cell of distance
+const float ALBEDO_EPSILON = 0.01f;  //Added to the albedo colour is divided by, so black surfaces keep their highlights
+
+void AuxBuffers::resize(int width, int height) {
+    this->width = width;
+    this->height = height;
+    size_t n = (size_t)width * height;
+    albedo.assign(n, glm::vec3(0));
+    normal.assign(n, glm::vec3(0));
+    depth.assign(n, NO_HIT_DEPTH);
+    samples.assign(n, 0);
+}
+
+// Running mean, so a cell is never more than one sample away from ready
+void AuxBuffers::add(size_t cell, const AuxSample& sample) {
+    float n = (float)++samples[cell];
+    albedo[cell] += (sample.albedo - albedo[cell]) / n;
+    normal[cell] += (sample.normal - normal[cell]) / n;
+    depth[cell] += (sample.depth - depth[cell]) / n;
+}
+
+/*
+ * e^-x to within a few percent where it matters and 0 from x = 8 on. There is
+ * no comparison, which GCC will not vectorise without -fno-trapping-math, so
+ * the clamp to 0 is done with fabs.
+ */
+static inline float expNeg(float x) {
+    float t = 1.0f - x * 0.125f;
+    t = 0.5f * (t + std::fabs(t));
+    t *= t;
+    t *= t;
+    return t * t;
+}
+
+/*
+ * One row of one iteration: every cell of row y is the weighted mean of the
+ * 5 x 5 cells around it, step cells apart. The taps are the outer loops, so
+ * the inner loop runs along the row over contiguous floats. sums is scratch
+ * for 4 rows that nothing else points into, and saying so with __restrict
+ * spares the compiler from checking before it vectorises.
+ */
+void Denoiser::filterRow(int y, float *__restrict sums) {
+    static const float h[5] = { 1.0f / 16, 1.0f / 4, 3.0f / 8, 1.0f / 4, 1.0f / 16 };
+    const int width = guide.width;
+    const int step = 1 << (pass - 1);
+    const Planes& in = planes;
+    Planes& out = filtered;
+    float *sumR = sums, *sumG = sums + width, *sumB = sums + 2 * width, *sumW = sums + 3 * width;
+    fill(sums, sums + 4 * width, 0.0f);
+
+    const size_t row = (size_t)y * width;
+    const float *pR = &in.r[row], *pG = &in.g[row], *pB = &in.b[row];
+    const float *pNx = &guide.nx[row], *pNy = &guide.ny[row], *pNz = &guide.nz[row], *pNormal2 = &guide.normal2[row];
+    const float *pDepth = &guide.depth[row], *pDepthWeight = &guide.depthWeight[row];
+    const float normalWeight = 1.0f / NORMAL_SIGMA;
+
+    for (int j = -2; j <= 2; j++) {
+        const int yy = y + j * step;
+        if (yy < 0 || yy >= guide.height) continue;
+        const size_t qRow = (size_t)yy * width;
+        const float *qR = &in.r[qRow], *qG = &in.g[qRow], *qB = &in.b[qRow];
+        const float *qNx = &guide.nx[qRow], *qNy = &guide.ny[qRow], *qNz = &guide.nz[qRow];
+        const float *qDepth = &guide.depth[qRow];
+
+        for (int i = -2; i <= 2; i++) {
+            const int dx = i * step;
+            const int x0 = std::max(0, -dx), x1 = std::min(width, width - dx);
+            const float kernel = h[j + 2] * h[i + 2];
+            const float invDistance = (i == 0 && j == 0) ? 0.0f : 1.0f / (step * std::sqrt((float)(i * i + j * j)));
+            for (int x = x0; x < x1; x++) {
+                const int q = x + dx;
+                float dr = qR[q] - pR[x], dg = qG[q] - pG[x], db = qB[q] - pB[x];
+                float dColor = (dr * dr + dg * dg + db * db) * colorWeight;
+                float dNormal = std::fabs(pNormal2[x] - (pNx[x] * qNx[q] + pNy[x] * qNy[q] + pNz[x] * qNz[q])) * normalWeight;
+                float dDepth = std::fabs(qDepth[q] - pDepth[x]) * pDepthWeight[x] * invDistance;
+                float w = kernel * expNeg(dColor + dNormal + dDepth);
+                sumR[x] += w * qR[q];
+                sumG[x] += w * qG[q];
+                sumB[x] += w * qB[q];
+                sumW[x] += w;
+            }
+        }
+    }
+
+    // the centre tap compares the cell with itself, so it always has weight and sumW is never 0
+    for (int x = 0; x < width; x++) {
+        out.r[row + x] = sumR[x] / sumW[x];
+        out.g[row + x] = sumG[x] / sumW[x];
+        out.b[row + x] = sumB[x] / sumW[x];
+    }
+}
+
+// The lighting alone is filtered, so the filter never blurs a texture
+Denoiser::Denoiser(const vector<glm::vec3>& color, const AuxBuffers& aux)
+    : aux(aux),
+      planes{ vector<float>(color.size()), vector<float>(color.size()), vector<float>(color.size()) },
+      filtered{ vector<float>(color.size()), vector<float>(color.size()), vector<float>(color.size()) },
+      guide{ aux.width, aux.height, vector<float>(color.size()), vector<float>(color.size()), vector<float>(color.size()),
+             vector<float>(color.size()), aux.depth, vector<float>(color.size()) },
+      colorWeight(1.0f / (COLOR_SIGMA * COLOR_SIGMA)) {
+    for (size_t i = 0; i < color.size(); i++) {
+        glm::vec3 lighting = color[i] / (aux.albedo[i] + ALBEDO_EPSILON);
+        planes.r[i] = lighting.r;
+        planes.g[i] = lighting.g;
+        planes.b[i] = lighting.b;
+        guide.nx[i] = aux.normal[i].x;
+        guide.ny[i] = aux.normal[i].y;
+        guide.nz[i] = aux.normal[i].z;
+        guide.normal2[i] = glm::dot(aux.normal[i], aux.normal[i]);
+    }
+}
+
+/*
+ * The smaller one-sided difference in each direction, so a cell at an
+ * object's edge takes the slope of its own surface, not the jump past it
+ */
+void Denoiser::depthWeightRow(int y) {
+    const int width = guide.width, height = guide.height;
+    const float *depth = &aux.depth[(size_t)y * width];
+    const float none = numeric_limits<float>::infinity();   //No neighbour on that side
+    for (int x = 0; x < width; x++) {
+        float sx = std::min(x > 0 ? std::fabs(depth[x] - depth[x - 1]) : none,
+                            x + 1 < width ? std::fabs(depth[x + 1] - depth[x]) : none);
+        float sy = std::min(y > 0 ? std::fabs(depth[x] - depth[x - width]) : none,
+                            y + 1 < height ? std::fabs(depth[x + width] - depth[x]) : none);
+        float slope = std::max(sx == none ? 0.0f : sx, sy == none ? 0.0f : sy);
+        guide.depthWeight[(size_t)y * width + x] = 1.0f / (DEPTH_SIGMA * slope + 1.e-3f);
+    }
+}
+
+void Denoiser::filterBand(int band, vector<float>& scratch) {
+    const int y0 = band * DENOISE_BAND, y1 = std::min(guide.height, y0 + DENOISE_BAND);
+    if (pass == 0) {
+        for (int y = y0; y < y1; y++) depthWeightRow(y);
+        return;
+    }
+    scratch.resize(4 * (size_t)guide.width);
+    for (int y = y0; y < y1; y++) filterRow(y, scratch.data());
+}
+
+// Each iteration spreads the taps twice as far and halves the colour sigma
+bool Denoiser::nextPass() {
+    if (pass > 0) {
+        swap(planes, filtered);
+        colorWeight *= 4;
+    }
+    return ++pass <= DENOISE_ITERATIONS;
+}
+
+void Denoiser::getImage(vector<glm::vec3>& out) const {
+    out.resize(planes.r.size());
+    for (size_t i = 0; i < out.size(); i++) {
+        out[i] = glm::vec3(planes.r[i], planes.g[i], planes.b[i]) * (aux.albedo[i] + ALBEDO_EPSILON);
+    }
+}
+
+// numThreads threads take bands of each pass in turn
+void denoise(const vector<glm::vec3>& color, const AuxBuffers& aux, int numThreads, vector<glm::vec3>& out) {
+    ProfileScope scope("denoise");
+    Denoiser denoiser(color, aux);
+    const int numBands = denoiser.getNumBands();
+    numThreads = std::max(1, std::min(numThreads, numBands));
+    do {
+        atomic<int> nextBand(0);
+        auto worker = [&] {
+            vector<float> scratch;
+            for (int band = nextBand++; band < numBands; band = nextBand++) denoiser.filterBand(band, scratch);
+        };
+        vector<thread> threads;
+        for (int i = 1; i < numThreads; i++) threads.emplace_back(worker);
+        worker();
+        for (thread& t : threads) t.join();
+    } while (denoiser.nextPass());
+    denoiser.getImage(out);
+}
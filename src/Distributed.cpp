@@ -0,0 +1,304 @@
+#include "Distributed.h"
+#include <cerrno>
+#include <cstring>
+#include <cstdint>
+#include <memory>
+#include <algorithm>
+#include <thread>
+#include <chrono>
+#include <sstream>
+#include <iostream>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include "Scene.h"
+#include "Config.h"
+#include "Socket.h"
+#include "TextureCache.h"
+using namespace std;
+
+// Messages are framed as described in Socket.h
+enum MessageType : uint32_t {
+    MSG_HELLO = 1,      // worker: thread count, then its name
+    MSG_JOB = 2,        // coordinator: scene name, a newline, then the settings as config lines
+    MSG_REQUEST = 3,    // worker: the number of tiles it wants
+    MSG_TILES = 4,      // coordinator: tile numbers, none when the frame is finished
+    MSG_PIXELS = 5      // worker: tile number, then RGB of each of its cells, row by row
+};
+
+const int CONNECT_ATTEMPTS = 50;        // workers may start before the coordinator
+const int CONNECT_RETRY_MS = 100;
+
+//---Coordinator -------------------------------------------------------------------
+
+RenderCoordinator::~RenderCoordinator() {
+    for (Worker& w : workers) close(w.fd);
+    if (listenFd >= 0) close(listenFd);
+    if (!unixPath.empty()) unlink(unixPath.c_str());
+}
+
+bool RenderCoordinator::listen(const string& address) {
+    listenFd = openSocket(address, true, unixPath);
+    if (listenFd < 0) {
+        cout << "Error :: Unable to listen on " << address << ": " << strerror(errno) << endl;
+        return false;
+    }
+    cout << "Listening for workers on " << address << endl;
+    return true;
+}
+
+void RenderCoordinator::acceptWorker() {
+    int fd = accept(listenFd, nullptr, nullptr);
+    if (fd < 0) return;
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));    // fails harmlessly on Unix sockets
+    Worker w;
+    w.fd = fd;
+    workers.push_back(w);
+}
+
+// Closes the worker's connection and puts the tiles it still had back in the queue
+void RenderCoordinator::dropWorker(size_t index, vector<int>& pending) {
+    Worker& w = workers[index];
+    if (!w.assigned.empty()) {
+        cout << "Worker " << w.name << " disconnected, requeueing " << w.assigned.size() << " tiles" << endl;
+    }
+    pending.insert(pending.end(), w.assigned.begin(), w.assigned.end());
+    close(w.fd);
+    workers.erase(workers.begin() + index);
+}
+
+bool RenderCoordinator::sendJob(Worker& worker) {
+    worker.assigned.clear();
+    worker.requested = 0;
+    worker.tilesRendered = 0;
+    worker.hasJob = sendMessage(worker.fd, MSG_JOB, job);
+    return worker.hasJob;
+}
+
+// Handles one message from the worker, returns false if the worker should be dropped
+bool RenderCoordinator::receive(Worker& worker, vector<glm::vec3>& framebuffer, int& tilesReceived) {
+    uint32_t type;
+    string payload;
+    if (!recvMessage(worker.fd, type, payload)) return false;
+
+    if (type == MSG_HELLO && payload.size() >= 4) {
+        worker.numThreads = getU32(payload, 0);
+        worker.name = payload.substr(4);
+        return true;
+    }
+    if (type == MSG_REQUEST && payload.size() == 4) {
+        worker.requested = getU32(payload, 0);
+        return true;
+    }
+    if (type != MSG_PIXELS || payload.size() < 4) return false;
+
+    int tile = getU32(payload, 0);
+    auto it = find(worker.assigned.begin(), worker.assigned.end(), tile);
+    if (it == worker.assigned.end()) return false;
+    TileRect rect = tileRect(tile, frameSettings.width, frameSettings.height);
+    if (payload.size() != 4 + (size_t)rect.numCells() * 12) return false;
+
+    size_t offset = 4;
+    for (int j = rect.y0; j < rect.y1; j++) {
+        for (int i = rect.x0; i < rect.x1; i++) {
+            glm::vec3& col = framebuffer[(size_t)j * frameSettings.width + i];
+            col.r = getFloat(payload, offset);
+            col.g = getFloat(payload, offset + 4);
+            col.b = getFloat(payload, offset + 8);
+            offset += 12;
+        }
+    }
+    worker.assigned.erase(it);
+    worker.tilesRendered++;
+    tilesReceived++;
+    return true;
+}
+
+/*
+ * Waits on the listening socket and every worker at once. New workers are
+ * sent the job as soon as they connect; a worker asking for tiles gets up
+ * to as many as it asked for from the queue. The frame is finished once
+ * every tile has come back and every worker is waiting for more, which
+ * they are then told there are none of.
+ */
+bool RenderCoordinator::render(const string& sceneName, const RenderSettings& settings, vector<glm::vec3>& framebuffer) {
+    if (listenFd < 0) return false;
+    ostringstream jobText;
+    jobText << sceneName << "\n";
+    writeSettings(jobText, settings);
+    job = jobText.str();
+    frameSettings = settings;
+    framebuffer.assign((size_t)settings.width * settings.height, glm::vec3(0));
+
+    const int numTiles = tileCount(settings.width, settings.height);
+    vector<int> pending;
+    for (int tile = numTiles - 1; tile >= 0; tile--) pending.push_back(tile);   // handed out from the back
+    int tilesReceived = 0;
+
+    for (size_t i = 0; i < workers.size();) {
+        if (sendJob(workers[i])) i++;
+        else dropWorker(i, pending);
+    }
+    if (workers.empty()) cout << "Waiting for workers..." << endl;
+
+    while (true) {
+        bool allWaiting = true;
+        for (const Worker& w : workers) allWaiting = allWaiting && w.requested > 0;
+        if (tilesReceived == numTiles && allWaiting) break;
+
+        vector<pollfd> fds(workers.size() + 1);
+        fds[0] = { listenFd, POLLIN, 0 };
+        for (size_t i = 0; i < workers.size(); i++) fds[i + 1] = { workers[i].fd, POLLIN, 0 };
+        if (poll(fds.data(), fds.size(), -1) < 0) {
+            if (errno == EINTR) continue;
+            cout << "Error :: poll failed: " << strerror(errno) << endl;
+            return false;
+        }
+
+        // workers after the last one polled are new, there is nothing to read from them yet
+        size_t numPolled = workers.size();
+        if (fds[0].revents & POLLIN) acceptWorker();
+        for (size_t i = numPolled; i > 0; i--) {
+            if (fds[i].revents == 0) continue;
+            if (!receive(workers[i - 1], framebuffer, tilesReceived)) dropWorker(i - 1, pending);
+        }
+
+        for (size_t i = 0; i < workers.size();) {
+            Worker& w = workers[i];
+            bool ok = w.hasJob || sendJob(w);
+            if (ok && w.requested > 0 && !pending.empty()) {
+                string tiles;
+                for (int n = 0; n < w.requested && !pending.empty(); n++) {
+                    w.assigned.push_back(pending.back());
+                    putU32(tiles, pending.back());
+                    pending.pop_back();
+                }
+                w.requested = 0;
+                ok = sendMessage(w.fd, MSG_TILES, tiles);
+            }
+            if (ok) i++;
+            else dropWorker(i, pending);
+        }
+    }
+
+    for (Worker& w : workers) {
+        sendMessage(w.fd, MSG_TILES, "");    // the frame is finished
+        w.requested = 0;
+        w.hasJob = false;
+    }
+    return true;
+}
+
+void RenderCoordinator::printWorkers() const {
+    for (const Worker& w : workers) {
+        cout << "  " << w.name << " (" << w.numThreads << " threads): " << w.tilesRendered << " tiles" << endl;
+    }
+}
+
+//---Worker ------------------------------------------------------------------------
+
+static int connectWithRetry(const string& address) {
+    string unixPath;
+    for (int attempt = 0; attempt < CONNECT_ATTEMPTS; attempt++) {
+        int fd = openSocket(address, false, unixPath);
+        if (fd >= 0) return fd;
+        this_thread::sleep_for(chrono::milliseconds(CONNECT_RETRY_MS));
+    }
+    cout << "Error :: Unable to connect to " << address << ": " << strerror(errno) << endl;
+    return -1;
+}
+
+/*
+ * Renders the frames the coordinator sends. The scene is kept between
+ * frames and only rebuilt when the job names a different one. Each batch
+ * of tiles is rendered on all threads before asking for the next.
+ */
+bool runRenderWorker(const string& address, int numThreads) {
+    int fd = connectWithRetry(address);
+    if (fd < 0) return false;
+
+    char host[256] = "unknown";
+    gethostname(host, sizeof(host) - 1);
+    string hello;
+    putU32(hello, numThreads);
+    hello += string(host) + ":" + to_string(getpid());
+
+    unique_ptr<TextureCache> textureCache;
+    unique_ptr<Scene> scene;
+    string sceneName;
+    bool ok = sendMessage(fd, MSG_HELLO, hello);
+
+    uint32_t type;
+    string payload;
+    while (ok && recvMessage(fd, type, payload)) {
+        if (type != MSG_JOB) {
+            ok = false;
+            break;
+        }
+        size_t newline = payload.find('\n');
+        string name = payload.substr(0, newline);
+        istringstream settingsText(newline == string::npos ? "" : payload.substr(newline + 1));
+        RenderSettings settings;
+        if (newline == string::npos || !parseConfig(settingsText, "job", settings)) {
+            ok = false;
+            break;
+        }
+        settings.numThreads = numThreads;       // the only setting that doesn't change the image
+        settings.printRayDebug = false;
+
+        if (!scene || name != sceneName) {
+            scene.reset();
+            textureCache.reset(new TextureCache());
+            scene.reset(new Scene());
+            if (!buildScene(name, *scene, *textureCache)) {
+                ok = false;
+                break;
+            }
+            scene->build();
+            sceneName = name;
+        }
+
+        Renderer renderer(scene.get(), settings);
+        renderer.beginFrame();
+        int tilesRendered = 0;
+        while (ok) {
+            string request;
+            putU32(request, numThreads);
+            ok = sendMessage(fd, MSG_REQUEST, request) && recvMessage(fd, type, payload) && type == MSG_TILES;
+            if (!ok || payload.empty()) break;
+
+            vector<int> tiles;
+            for (size_t offset = 0; offset + 4 <= payload.size(); offset += 4) {
+                int tile = getU32(payload, offset);
+                if (tile < 0 || tile >= renderer.getNumTiles()) ok = false;
+                tiles.push_back(tile);
+            }
+            if (!ok) break;
+            renderer.renderTiles(tiles);
+
+            for (int tile : tiles) {
+                TileRect rect = tileRect(tile, settings.width, settings.height);
+                string pixels;
+                pixels.reserve(4 + rect.numCells() * 12);
+                putU32(pixels, tile);
+                for (int j = rect.y0; j < rect.y1; j++) {
+                    for (int i = rect.x0; i < rect.x1; i++) {
+                        const glm::vec3& col = renderer.getPixel(i, j);
+                        putFloat(pixels, col.r);
+                        putFloat(pixels, col.g);
+                        putFloat(pixels, col.b);
+                    }
+                }
+                ok = ok && sendMessage(fd, MSG_PIXELS, pixels);
+            }
+            tilesRendered += tiles.size();
+        }
+        if (ok) cout << "Rendered " << tilesRendered << " tiles of " << sceneName << endl;
+    }
+    close(fd);
+    if (!ok) cout << "Error :: Lost the connection to the coordinator" << endl;
+    return ok;
+}
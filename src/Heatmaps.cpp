@@ -0,0 +1,72 @@
+#include "Heatmaps.h"
+#include "ImageWriter.h"
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+using namespace std;
+
+void Heatmaps::resize(int width, int height) {
+    this->width = width;
+    this->height = height;
+    size_t n = (size_t)width * height;
+    nodeVisits.assign(n, 0);
+    primitiveTests.assign(n, 0);
+    bounceDepth.assign(n, 0);
+    nanoseconds.assign(n, 0.0f);
+}
+
+/*
+ * Raw maps start with a 16 byte header: "RTHM", the width and height as
+ * little-endian int32, and the value type ('u' for uint32, 'f' for float32)
+ * padded to 4 bytes. The values follow in framebuffer order.
+ */
+template <typename T>
+static bool writeRaw(const string& path, int width, int height, char type, const vector<T>& values) {
+    ofstream out(path, ios::binary);
+    if (!out) {
+        cout << "Error :: Unable to open " << path << endl;
+        return false;
+    }
+    int32_t dims[2] = { width, height };
+    char typeTag[4] = { type, 0, 0, 0 };
+    out.write("RTHM", 4);
+    out.write((const char*)dims, sizeof(dims));
+    out.write(typeTag, sizeof(typeTag));
+    out.write((const char*)values.data(), values.size() * sizeof(T));
+    return (bool)out;
+}
+
+// False colour image scaled so the 99th percentile is white, so a few
+// outliers (a thread being preempted mid-pixel) don't wash out the rest
+template <typename T>
+static bool writeFalseColour(const string& path, int width, int height, const vector<T>& values) {
+    vector<T> sorted = values;
+    size_t p99 = sorted.size() * 99 / 100;
+    float maxValue = 0.0f;
+    if (!sorted.empty()) {
+        std::nth_element(sorted.begin(), sorted.begin() + p99, sorted.end());
+        maxValue = (float)sorted[p99];
+    }
+    vector<glm::vec3> pixels(values.size());
+    for (size_t i = 0; i < values.size(); i++) {
+        pixels[i] = falseColour(maxValue > 0.0f ? values[i] / maxValue : 0.0f);
+    }
+    return writeBMP(path, width, height, pixels);
+}
+
+/*
+ * Writes each map as prefix_<name>.bmp (false colour) and prefix_<name>.raw
+ */
+bool Heatmaps::write(const string& prefix) const {
+    bool ok = true;
+    ok &= writeFalseColour(prefix + "_nodes.bmp", width, height, nodeVisits);
+    ok &= writeRaw(prefix + "_nodes.raw", width, height, 'u', nodeVisits);
+    ok &= writeFalseColour(prefix + "_tests.bmp", width, height, primitiveTests);
+    ok &= writeRaw(prefix + "_tests.raw", width, height, 'u', primitiveTests);
+    ok &= writeFalseColour(prefix + "_depth.bmp", width, height, bounceDepth);
+    ok &= writeRaw(prefix + "_depth.raw", width, height, 'u', bounceDepth);
+    ok &= writeFalseColour(prefix + "_time.bmp", width, height, nanoseconds);
+    ok &= writeRaw(prefix + "_time.raw", width, height, 'f', nanoseconds);
+    return ok;
+}
@@ -0,0 +1,73 @@
+#include "ImageWriter.h"
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+using namespace std;
+
+static void putU16(ofstream& out, uint16_t v) {
+    out.put(v & 0xff);
+    out.put((v >> 8) & 0xff);
+}
+
+static void putU32(ofstream& out, uint32_t v) {
+    putU16(out, v & 0xffff);
+    putU16(out, v >> 16);
+}
+
+/*
+ * BMP rows are stored bottom up, the same order as the framebuffer,
+ * each padded to a multiple of 4 bytes.
+ */
+bool writeBMP(const string& path, int width, int height, const vector<glm::vec3>& pixels) {
+    ofstream out(path, ios::binary);
+    if (!out) {
+        cout << "Error :: Unable to open " << path << endl;
+        return false;
+    }
+
+    const int rowSize = (width * 3 + 3) & ~3;
+    const uint32_t dataSize = rowSize * height;
+
+    // file header
+    out.put('B');
+    out.put('M');
+    putU32(out, 54 + dataSize);
+    putU32(out, 0);
+    putU32(out, 54);
+    // info header
+    putU32(out, 40);
+    putU32(out, width);
+    putU32(out, height);
+    putU16(out, 1);     // planes
+    putU16(out, 24);    // bits per pixel
+    putU32(out, 0);     // no compression
+    putU32(out, dataSize);
+    putU32(out, 2835);  // 72 dpi
+    putU32(out, 2835);
+    putU32(out, 0);
+    putU32(out, 0);
+
+    vector<unsigned char> row(rowSize, 0);
+    for (int j = 0; j < height; j++) {
+        for (int i = 0; i < width; i++) {
+            glm::vec3 c = pixels[j * width + i];
+            row[i * 3 + 0] = (unsigned char)(std::min(std::max(c.b, 0.0f), 1.0f) * 255.0f + 0.5f);
+            row[i * 3 + 1] = (unsigned char)(std::min(std::max(c.g, 0.0f), 1.0f) * 255.0f + 0.5f);
+            row[i * 3 + 2] = (unsigned char)(std::min(std::max(c.r, 0.0f), 1.0f) * 255.0f + 0.5f);
+        }
+        out.write((const char*)row.data(), rowSize);
+    }
+    return (bool)out;
+}
+
+glm::vec3 falseColour(float t) {
+    static const glm::vec3 ramp[] = {
+        glm::vec3(0, 0, 0), glm::vec3(0, 0, 1), glm::vec3(0, 1, 1), glm::vec3(0, 1, 0),
+        glm::vec3(1, 1, 0), glm::vec3(1, 0, 0), glm::vec3(1, 1, 1)
+    };
+    const int last = sizeof(ramp) / sizeof(ramp[0]) - 1;
+    t = std::min(std::max(t, 0.0f), 1.0f) * last;
+    int i = std::min((int)t, last - 1);
+    return glm::mix(ramp[i], ramp[i + 1], t - i);
+}
@@ -0,0 +1,58 @@
+#include "Light.h"
+#include <cfloat>
+#include <cmath>
+
+/*
+ * Relative power of the light, used to decide how often it is sampled
+ */
+float Light::power() {
+    float luminance = 0.2126f * color_.r + 0.7152f * color_.g + 0.0722f * color_.b;
+    return intensity_ * luminance;
+}
+
+static LightSample sampleTowards(const glm::vec3& p, const glm::vec3& target, const glm::vec3& radiance) {
+    LightSample s;
+    glm::vec3 lightVec = target - p;
+    s.dist = glm::length(lightVec);
+    s.dir = lightVec / s.dist;
+    s.radiance = radiance;
+    return s;
+}
+
+// Only lights with an area use (u1, u2)
+LightSample PointLight::sample(const glm::vec3& p, float, float) {
+    return sampleTowards(p, position, intensity_ * color_);
+}
+
+LightSample DirectionalLight::sample(const glm::vec3&, float, float) {
+    LightSample s;
+    s.dir = -direction;
+    s.dist = FLT_MAX;
+    s.radiance = intensity_ * color_;
+    return s;
+}
+
+SpotLight::SpotLight(glm::vec3 position, glm::vec3 direction, float cutoffDegrees, float exponent, glm::vec3 color, float intensity) :
+    Light(color, intensity), position(position), direction(glm::normalize(direction)), exponent(exponent) {
+    cosCutoff = cos(cutoffDegrees * M_PI / 180.0);
+}
+
+LightSample SpotLight::sample(const glm::vec3& p, float, float) {
+    LightSample s = sampleTowards(p, position, intensity_ * color_);
+    float cosAngle = glm::dot(-s.dir, direction);
+    if (cosAngle < cosCutoff) {
+        s.radiance = glm::vec3(0);
+    } else {
+        s.radiance *= pow(cosAngle, exponent);
+    }
+    return s;
+}
+
+float SpotLight::power() {
+    // only the fraction of the sphere covered by the cone receives light
+    return Light::power() * 0.5f * (1.0f - cosCutoff);
+}
+
+LightSample QuadLight::sample(const glm::vec3& p, float u1, float u2) {
+    return sampleTowards(p, corner + u1 * edge1 + u2 * edge2, intensity_ * color_);
+}
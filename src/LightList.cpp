@@ -0,0 +1,63 @@
+#include "LightList.h"
+#include <algorithm>
+
+/*
+ * Builds the alias table (Vose's method) from the power of each light.
+ */
+void LightList::build() {
+    size_t n = lights.size();
+    pmfs.assign(n, 0.0f);
+    probs.assign(n, 1.0f);
+    aliases.assign(n, 0);
+    if (n == 0) return;
+
+    float total = 0.0f;
+    for (size_t i = 0; i < n; i++) {
+        pmfs[i] = std::max(lights[i]->power(), 0.0f);
+        total += pmfs[i];
+    }
+    for (size_t i = 0; i < n; i++) {
+        pmfs[i] = (total > 0.0f) ? pmfs[i] / total : 1.0f / n;
+    }
+
+    // split the buckets into those under and over the average probability
+    std::vector<float> scaled(n);
+    std::vector<int> small, large;
+    for (size_t i = 0; i < n; i++) {
+        scaled[i] = pmfs[i] * n;
+        aliases[i] = i;
+        if (scaled[i] < 1.0f) small.push_back(i);
+        else large.push_back(i);
+    }
+
+    // top up each small bucket from a large one
+    while (!small.empty() && !large.empty()) {
+        int s = small.back(); small.pop_back();
+        int l = large.back();
+        probs[s] = scaled[s];
+        aliases[s] = l;
+        scaled[l] -= 1.0f - scaled[s];
+        if (scaled[l] < 1.0f) {
+            large.pop_back();
+            small.push_back(l);
+        }
+    }
+}
+
+/*
+ * Picks a light using the uniform random number u in [0, 1).
+ * pmf is set to the probability the returned light had of being picked.
+ */
+int LightList::sample(float u, float& pmf) const {
+    float scaled = u * lights.size();
+    int i = std::min((int)scaled, (int)lights.size() - 1);
+    int picked = (scaled - i < probs[i]) ? i : aliases[i];
+    pmf = pmfs[picked];
+    return picked;
+}
+
+void LightList::clear() {
+    for (Light* light : lights) delete light;
+    lights.clear();
+    build();
+}
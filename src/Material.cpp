@@ -0,0 +1,149 @@
+#include "Material.h"
+#include <cmath>
+#include <iostream>
+#include <algorithm>
+using namespace std;
+
+void Material::setRefractivity(bool flag, float refr_coeff, float refr_index) {
+    refr_ = flag;
+    refrc_ = refr_coeff;
+    refri_ = refr_index;
+}
+
+void Material::addStripe(float width, glm::vec3 direction, vector<glm::vec3> colors) {
+    Pattern stripe;
+    stripe.type = PATTERN_STRIPE;
+    stripe.width = width;
+    stripe.direction = direction;
+    stripe.colors = colors;
+    layers_.push_back(stripe);
+}
+
+void Material::addChecker(float width, glm::vec3 color1, glm::vec3 color2) {
+    Pattern checker;
+    checker.type = PATTERN_CHECKER;
+    checker.width = width;
+    checker.colors = { color1, color2 };
+    layers_.push_back(checker);
+}
+
+void Material::addTexture(TextureHandle texture) {
+    Pattern image;
+    image.type = PATTERN_TEXTURE;
+    image.texture = texture;
+    layers_.push_back(image);
+}
+
+glm::vec3 Material::colorAt(SceneObject* obj, const glm::vec3& hit, const glm::vec2& uv, const RayDifferential& footprint) const {
+    glm::vec3 color = color_;
+    for (const Pattern& layer : layers_) color = layer.apply(color, obj, hit, uv, footprint);
+    return color;
+}
+
+/*
+ * Phong lighting from each of the light samples. The radiance of each
+ * sample already includes any shadowing between the hit and the light.
+ */
+LightingResult Material::lighting(const LightSample* lights, int numLights, const glm::vec3& viewVec,
+                                  const glm::vec3& normalVec, const glm::vec3& color) const {
+    float ambient = 0.2;
+
+    glm::vec3 diffuseColor(0);
+    glm::vec3 specularColor(0);
+    for (int i = 0; i < numLights; i++) {
+        const LightSample& light = lights[i];
+        float lDotn = glm::dot(light.dir, normalVec);
+        if (lDotn > 0) diffuseColor += lDotn * light.radiance * color;
+        if (spec_) {
+            glm::vec3 reflVec = glm::reflect(-light.dir, normalVec);
+            float rDotv = glm::dot(reflVec, viewVec);
+            if (rDotv > 0) specularColor += (float)pow((double)rDotv, (double)shin_) * light.radiance;
+        }
+    }
+
+    glm::vec3 ambientColor = ambient * color;
+
+    return LightingResult{ ambientColor, diffuseColor, specularColor };
+}
+
+//---Patterns ------------------------------------------------------------------------
+
+// Integral of the square wave that is +1 on even cells and -1 on odd cells
+static float squareWaveIntegral(float x) {
+    return 1.0f - fabs(2.0f * (x / 2.0f - std::floor(x / 2.0f)) - 1.0f);
+}
+
+// Square wave averaged over a box of width w centred on x, in units of cells
+static float filteredSquareWave(float x, float w) {
+    if (w < 1.e-4) return (static_cast<int>(std::floor(x)) % 2 == 0) ? 1.0f : -1.0f;
+    return (squareWaveIntegral(x + 0.5f * w) - squareWaveIntegral(x - 0.5f * w)) / w;
+}
+
+// Each stripe weighted by how much of the footprint it covers
+static glm::vec3 stripeColor(const Pattern& stripe, const glm::vec3& hit, const RayDifferential& footprint) {
+    float projection = glm::dot(hit, stripe.direction) / stripe.width;
+    float width = footprint.width(stripe.direction) / stripe.width;
+    int numColors = stripe.colors.size();
+    glm::vec3 color(0);
+    if (width >= numColors) {
+        // footprint covers the whole pattern
+        for (const glm::vec3& c : stripe.colors) color += c;
+        return color / (float)numColors;
+    }
+    float lo = projection - 0.5f * width;
+    float hi = projection + 0.5f * width;
+    int first = static_cast<int>(std::floor(lo));
+    int last = static_cast<int>(std::floor(hi));
+    for (int stripeIndex = first; stripeIndex <= last; stripeIndex++) {
+        float coverage = (width > 0) ? (std::min(hi, stripeIndex + 1.0f) - std::max(lo, (float)stripeIndex)) / width : 1.0f;
+        int colorIndex = stripeIndex % numColors;
+        if (colorIndex < 0) colorIndex += numColors;
+        color += coverage * stripe.colors[colorIndex];
+    }
+    return color;
+}
+
+glm::vec3 Pattern::apply(const glm::vec3& below, SceneObject* obj, const glm::vec3& hit, const glm::vec2& uv,
+                         const RayDifferential& footprint) const {
+    switch (type) {
+        case PATTERN_STRIPE:
+            return colors.empty() ? below : stripeColor(*this, hit, footprint);
+        case PATTERN_CHECKER: {
+            glm::vec3 axis1, axis2;
+            obj->patternAxes(hit, axis1, axis2);
+            float projection1 = glm::dot(hit, axis1) / width;
+            float projection2 = glm::dot(hit, axis2) / width;
+
+            // The checker is the product of a square wave along each axis.
+            // Filtering each axis separately filters the product exactly.
+            float wave1 = filteredSquareWave(projection1, footprint.width(axis1) / width);
+            float wave2 = filteredSquareWave(projection2, footprint.width(axis2) / width);
+
+            // cells where exactly one stripe index is even take color 1
+            float weight1 = 0.5f - 0.5f * wave1 * wave2;
+            return weight1 * colors[0] + (1 - weight1) * colors[1];
+        }
+        case PATTERN_TEXTURE: {
+            glm::vec2 st;
+            float filterWidth;
+            if (!texture || !obj->textureCoords(hit, uv, footprint, st, filterWidth)) return below;
+            return texture->getColorAt(st.x, st.y, filterWidth);
+        }
+    }
+    return below;
+}
+
+//---Material table ------------------------------------------------------------------
+
+MaterialId MaterialTable::add(const Material& material) {
+    if (materials.size() >= MAX_MATERIALS) {
+        cout << "Error :: More than " << MAX_MATERIALS << " materials, using the default material" << endl;
+        return DEFAULT_MATERIAL;
+    }
+    materials.push_back(material);
+    return (MaterialId)(materials.size() - 1);
+}
+
+void MaterialTable::clear() {
+    materials.assign(1, Material());
+}
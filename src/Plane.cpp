@@ -8,37 +8,76 @@
 
 #include "Plane.h"
 #include <math.h>
+#include <algorithm>
+
+/**
+* The dual basis of (e1, e2): the pair of vectors in their plane whose dot
+* products with q give q's coordinates along e1 and e2.
+*/
+static void dualBasis(const glm::vec3& e1, const glm::vec3& e2, glm::vec3& inv1, glm::vec3& inv2) {
+	glm::vec3 n = glm::cross(e1, e2);
+	float lenSq = glm::dot(n, n);
+	inv1 = glm::cross(e2, n) / lenSq;
+	inv2 = glm::cross(n, e1) / lenSq;
+}
+
+/**
+* Everything the intersection test and patterns need that depends only on the
+* vertices, so a ray costs one dot-divide and two dots for its coordinates.
+*/
+void Plane::precompute() {
+	normal_ = glm::normalize(glm::cross(c_-b_, a_-b_));
+	planeD_ = glm::dot(normal_, a_);
+	edgeU_ = b_ - a_;
+	edgeV_ = (nverts_ == 3 ? c_ : d_) - a_;
+	dualBasis(edgeU_, edgeV_, invU_, invV_);
+
+	parallelogram_ = true;
+	if (nverts_ == 4) {
+		glm::vec3 skew = (a_ + c_ - b_) - d_;
+		parallelogram_ = glm::dot(skew, skew) <= 1.e-10f * glm::dot(edgeV_, edgeV_);
+		dualBasis(b_ - a_, c_ - a_, triU_[0], triV_[0]);
+		dualBasis(c_ - a_, d_ - a_, triU_[1], triV_[1]);
+	}
+
+	checkerAxis1_ = glm::normalize(c_-b_);
+	checkerAxis2_ = glm::normalize(a_-b_);
+}
 
 /**
 * Plane's intersection method.  The input is a ray (p0, dir).
 * See slide Lec09-Slide 31
 */
-float Plane::intersect(glm::vec3 p0, glm::vec3 dir) {
-	// if (aabb_.intersect(p0, dir) == -1.0) return -1.0;  // No intersection if ray does not intersect AABB
+float Plane::intersect(const glm::vec3& p0, const glm::vec3& dir) {
+	glm::vec2 uv;
+	return intersectUV(p0, dir, uv);
+}
 
-	glm::vec3 n = normal(p0);
-	glm::vec3 vdif = a_ - p0;
-	float d_dot_n = glm::dot(dir, n);
+/**
+* Also gives the hit's coordinates along a->b and a->d (a->c for triangles),
+* 0 to 1 across a parallelogram and barycentric for a triangle.
+*/
+float Plane::intersectUV(const glm::vec3& p0, const glm::vec3& dir, glm::vec2& uv) {
+	float d_dot_n = glm::dot(dir, normal_);
 	if(fabs(d_dot_n) < 1.e-4) return -1;   //Ray parallel to the plane
 
-    float t = glm::dot(vdif, n)/d_dot_n;
+	float t = (planeD_ - glm::dot(p0, normal_)) / d_dot_n;
 	if(t < 0) return -1;
 
-	glm::vec3 q = p0 + dir*t; //Point of intersection
-	if( isInside(q) ) return t; //Inside the plane
-	else return -1; //Outside
+	glm::vec3 q = p0 + dir*t - a_; //Point of intersection, relative to a
+	float u = glm::dot(q, invU_);
+	float v = glm::dot(q, invV_);
+	if(!contains(q, u, v)) return -1; //Outside
+	uv = glm::vec2(u, v);
+	return t;
 }
 
 /**
 * Returns the unit normal vector at a given point.
 * Assumption: The input point p lies on the plane.
 */
-glm::vec3 Plane::normal(glm::vec3 p) {
-	glm::vec3 v1 = c_-b_;
-	glm::vec3 v2 = a_-b_;
-	glm::vec3 n = glm::cross(v1, v2);
-	n = glm::normalize(n);
-    return n;
+glm::vec3 Plane::normal(const glm::vec3&) {
+    return normal_;
 }
 
 /**
@@ -46,22 +85,22 @@ glm::vec3 Plane::normal(glm::vec3 p) {
 * Checks if a point q is inside the current polygon
 * See slide Lec09-Slide 33
 */
-bool Plane::isInside(glm::vec3 q) {
-	glm::vec3 n = normal(q);     //Normal vector at the point of intersection
-	glm::vec3 ua = b_ - a_, ub = c_ - b_, uc = d_ - c_, ud = a_ - d_;
-	glm::vec3 va = q - a_, vb = q - b_, vc = q - c_, vd = q - d_;
-	if (nverts_ == 3) uc = a_ - c_;
-	float ka = glm::dot(glm::cross(ua, va), n);
-	float kb = glm::dot(glm::cross(ub, vb), n);
-	float kc = glm::dot(glm::cross(uc, vc), n);
-	float kd;
-	if (nverts_ == 4)
-		kd = glm::dot(glm::cross(ud, vd), n);
-	else
-		kd = ka;
-	if (ka > 0 && kb > 0 && kc > 0 && kd > 0) return true;
-	if (ka < 0 && kb < 0 && kc < 0 && kd < 0) return true;
-	else return false;
+bool Plane::isInside(const glm::vec3& pt) {
+	glm::vec3 q = pt - a_;
+	return contains(q, glm::dot(q, invU_), glm::dot(q, invV_));
+}
+
+//Whether a point q (relative to a) with coordinates (u, v) lies inside the polygon
+bool Plane::contains(const glm::vec3& q, float u, float v) {
+	if (nverts_ == 3) return u > 0 && v > 0 && u + v < 1;
+	if (parallelogram_) return u > 0 && u < 1 && v > 0 && v < 1;
+
+	//Either triangle of a convex quad, the diagonal ac (s = 0 in the first, r = 0 in the second) included once
+	float s = glm::dot(q, triU_[0]), r = glm::dot(q, triV_[0]);
+	if (s >= 0 && r > 0 && s + r < 1) return true;
+	s = glm::dot(q, triU_[1]);
+	r = glm::dot(q, triV_[1]);
+	return s > 0 && r > 0 && s + r < 1;
 }
 
 //Getter function for number of vertices
@@ -75,7 +114,7 @@ void Plane::calculateAABB() {
 	switch(nverts_) {
 		case 3:
 			minPoint = glm::min(a_, glm::min(b_, c_));
-			maxPoint = glm::max(b_, glm::max(b_, c_));
+			maxPoint = glm::max(a_, glm::max(b_, c_));
 			break;
 		case 4:
 			minPoint = glm::min(a_, glm::min(b_, glm::min(c_, d_)));
@@ -102,63 +141,30 @@ void Plane::calculateAABB() {
     aabb_ = AABB(minPoint, maxPoint);
 }
 
-glm::vec3 Plane::getColor(glm::vec3 hit) {
-	glm::vec3 color = color_;
-	if(stripe_) {
-		float projection = glm::dot(hit, stripeDirection_);
-		int stripeIndex = static_cast<int>(std::floor(projection / stripeWidth_));
-		int colorIndex = stripeIndex % stripeColors_.size();
-		if(colorIndex < 0) colorIndex += stripeColors_.size();
-		color = stripeColors_[colorIndex];
-	}
-	if(checkered_) {
-		float projection1 = glm::dot(hit, glm::normalize(c_-b_));
-		float projection2 = glm::dot(hit, glm::normalize(a_-b_));
-
-		int stripeIndex1 = static_cast<int>(std::floor(projection1 / checkeredWidth_));
-		int stripeIndex2 = static_cast<int>(std::floor(projection2 / checkeredWidth_));
-
-		// Use XOR to create a checkered pattern
-		bool isEven = (stripeIndex1 % 2 == 0) ^ (stripeIndex2 % 2 == 0);
-
-		color = isEven ? checkeredColor1_ : checkeredColor2_;
-	}
-	if(tex_) {
-		float u = (hit.x - texA_.x) / (texB_.x - texA_.x);
-		float v = (hit.z - texA_.y) / (texB_.y - texA_.y);
-		if(u > 0 && u < 1 &&
-		v > 0 && v < 1)
-		{
-			color=texture_.getColorAt(u, v);
-		}
-	}
-
-	return color;
+//Checkers are laid along the quad's edges
+void Plane::patternAxes(const glm::vec3&, glm::vec3& axis1, glm::vec3& axis2) {
+	axis1 = checkerAxis1_;
+	axis2 = checkerAxis2_;
 }
 
-void Plane::setStripe(bool flag, int stripeWidth, glm::vec3 stripeDirection, std::vector<glm::vec3> stripeColors) {
-	stripe_ = flag;
-	stripeWidth_ = stripeWidth;
-	stripeDirection_ = stripeDirection;
-	stripeColors_ = stripeColors;
-}
-
-void Plane::setCheckered(bool flag, int width, glm::vec3 color1, glm::vec3 color2) {
-	checkered_ = flag;
-	checkeredColor1_ = color1;
-	checkeredColor2_ = color2;
-	checkeredWidth_ = width;
-}
-
-void Plane::setTextured(bool flag) {
-	tex_ = flag;
+/**
+* The image is stretched over the quad, (0, 0) at a and (1, 1) at c; a
+* triangle takes the half of it from a to b and c.
+*/
+bool Plane::textureCoords(const glm::vec3&, const glm::vec2& uv, const RayDifferential& footprint, glm::vec2& st, float& filterWidth) {
+	st = uv;
+	float du = footprint.width(glm::normalize(edgeU_)) / glm::length(edgeU_);
+	float dv = footprint.width(glm::normalize(edgeV_)) / glm::length(edgeV_);
+	filterWidth = std::max(du, dv);
+	return true;
 }
 
-void Plane::setTexture(TextureBMP file) {
-	texture_ = file;
+void Plane::translate(glm::vec3 offset)
+{
+	a_ += offset;
+	b_ += offset;
+	c_ += offset;
+	d_ += offset;
+	precompute();
+	calculateAABB();
 }
-
-void Plane::setTexArea(glm::vec2 a, glm::vec2 b) {
-	texA_ = a;
-	texB_ = b;
-}
\ No newline at end of file
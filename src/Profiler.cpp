@@ -0,0 +1,78 @@
+#include "Profiler.h"
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+using namespace std;
+
+std::atomic<bool> Profiler::running(false);
+std::mutex Profiler::mutex;
+std::vector<Profiler::Event> Profiler::events;
+std::vector<std::pair<int, std::string>> Profiler::threadNames;
+std::chrono::steady_clock::time_point Profiler::origin;
+
+static thread_local int threadId = 0;    // the main thread is track 0
+
+void Profiler::start() {
+    std::lock_guard<std::mutex> lock(mutex);
+    events.clear();
+    threadNames.clear();
+    threadNames.push_back({ 0, "main" });
+    origin = std::chrono::steady_clock::now();
+    running = true;
+}
+
+void Profiler::setThread(int id, const string& name) {
+    threadId = id;
+    if (!isRunning()) return;
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const auto& t : threadNames) {
+        if (t.first == id) return;
+    }
+    threadNames.push_back({ id, name });
+}
+
+void Profiler::record(const char* name, const char* category, std::chrono::steady_clock::time_point start,
+                      std::chrono::steady_clock::time_point end, int64_t arg) {
+    Event e;
+    e.name = name;
+    e.category = category;
+    e.tid = threadId;
+    e.startUs = std::chrono::duration<double, std::micro>(start - origin).count();
+    e.durationUs = std::chrono::duration<double, std::micro>(end - start).count();
+    e.arg = arg;
+    std::lock_guard<std::mutex> lock(mutex);
+    if (running) events.push_back(e);
+}
+
+/*
+ * Ends the capture and writes it to path as complete ("X") events,
+ * with a metadata event naming each thread's track.
+ */
+bool Profiler::stop(const string& path) {
+    running = false;
+    std::lock_guard<std::mutex> lock(mutex);
+
+    ofstream out(path);
+    if (!out) {
+        cout << "Error :: Unable to open " << path << endl;
+        return false;
+    }
+    out << std::fixed << std::setprecision(3);
+    out << "{\"traceEvents\":[\n";
+    bool first = true;
+    for (const auto& t : threadNames) {
+        out << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << t.first
+            << ",\"args\":{\"name\":\"" << t.second << "\"}}";
+        first = false;
+    }
+    for (const Event& e : events) {
+        out << ",\n{\"name\":\"" << e.name << "\",\"cat\":\"" << e.category << "\",\"ph\":\"X\",\"pid\":1,\"tid\":"
+            << e.tid << ",\"ts\":" << e.startUs << ",\"dur\":" << e.durationUs;
+        if (e.arg >= 0) out << ",\"args\":{\"value\":" << e.arg << "}";
+        out << "}";
+    }
+    out << "\n]}\n";
+    cout << "Wrote " << events.size() << " trace events to " << path << endl;
+    events.clear();
+    return (bool)out;
+}
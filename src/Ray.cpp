@@ -3,35 +3,27 @@
 // The ray class (implementation)
 //==================================================
 #include "Ray.h"
+#include "BVH.h"
 
 //Finds the closest point of intersection of the current ray with scene objects
 int Ray::closestPt(std::vector<SceneObject*> &sceneObjects) {
 	int numIntersections = 0;
-	glm::vec3 point(0,0,0);
-	float tmin = 1.e+6;
-    for(int i = 0;  i < sceneObjects.size();  i++) {
-		float t = sceneObjects[i]->intersect(p0, dir);
+    for(int i = 0;  i < (int)sceneObjects.size();  i++) {
+		glm::vec2 uv(0.0f);
+		float t = sceneObjects[i]->intersectUV(p0, dir, uv);
 		numIntersections++;
-		if(t > 0) {        //Intersects the object
-			point = p0 + dir*t;
-			if(t < tmin) {
-				hit = point;
-				index = i;
-				dist = t;
-				tmin = t;
-			}
+		if(t > tMin && t < tMax) {        //Intersects the object, closer than any so far
+			hit.t = t;
+			hit.primID = i;
+			hit.u = uv.x;
+			hit.v = uv.y;
+			tMax = t;
 		}
 	}
 	return numIntersections;
 }
 
-int Ray::closestPt(BVH &bvh) {
-	glm::vec3 point(0,0,0);
-	struct RayHit rayhit = bvh.intersect(p0, dir);
-	if (rayhit.dist > 0) {
-		hit = rayhit.hit;
-		index = rayhit.objIdx;
-		dist = rayhit.dist;
-	}
-	return rayhit.numIntersections;
+//Returns the number of objects tested, and the number of BVH nodes tested in nodeVisits
+int Ray::closestPt(BVH &bvh, int *nodeVisits) {
+	return bvh.intersect(*this, nodeVisits);
 }
\ No newline at end of file
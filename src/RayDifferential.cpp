@@ -0,0 +1,81 @@
+#include "RayDifferential.h"
+
+/*
+ * Differentials of a primary ray through a pinhole. dir is the unnormalized
+ * direction to the pixel centre, dx and dy the step to the next pixel
+ * across and up on the image plane.
+ */
+RayDifferential RayDifferential::primary(glm::vec3 dir, glm::vec3 dx, glm::vec3 dy) {
+	RayDifferential diff;
+	float dd = glm::dot(dir, dir);
+	float invLen3 = 1.0f / (dd * sqrt(dd));
+	diff.dDdx = (dd * dx - glm::dot(dir, dx) * dir) * invLen3;
+	diff.dDdy = (dd * dy - glm::dot(dir, dy) * dir) * invLen3;
+	return diff;
+}
+
+/*
+ * Moves the differentials a distance t along the unit direction dir to a
+ * surface with unit normal n.
+ */
+RayDifferential RayDifferential::transfer(glm::vec3 dir, float t, glm::vec3 n) const {
+	RayDifferential diff = *this;
+	float dDotn = glm::dot(dir, n);
+	if (fabs(dDotn) < 1.e-6) return diff;
+
+	glm::vec3 px = dPdx + t * dDdx;
+	glm::vec3 py = dPdy + t * dDdy;
+	float dtdx = -glm::dot(px, n) / dDotn;
+	float dtdy = -glm::dot(py, n) / dDotn;
+	diff.dPdx = px + dtdx * dir;
+	diff.dPdy = py + dtdy * dir;
+	return diff;
+}
+
+/*
+ * Differentials of the mirror reflection of dir about n.
+ * dndx and dndy are the change in the surface normal across the footprint.
+ */
+RayDifferential RayDifferential::reflect(glm::vec3 dir, glm::vec3 n, glm::vec3 dndx, glm::vec3 dndy) const {
+	RayDifferential diff = *this;
+	float dDotn = glm::dot(dir, n);
+	float dDndx = glm::dot(dDdx, n) + glm::dot(dir, dndx);
+	float dDndy = glm::dot(dDdy, n) + glm::dot(dir, dndy);
+	diff.dDdx = dDdx - 2.0f * (dDotn * dndx + dDndx * n);
+	diff.dDdy = dDdy - 2.0f * (dDotn * dndy + dDndy * n);
+	return diff;
+}
+
+/*
+ * Differentials of the refraction of dir through n (facing against dir)
+ * with relative refractive index eta, matching glm::refract.
+ */
+RayDifferential RayDifferential::refract(glm::vec3 dir, glm::vec3 n, glm::vec3 dndx, glm::vec3 dndy, float eta) const {
+	RayDifferential diff = *this;
+	float dDotn = glm::dot(dir, n);
+	float k = 1.0f - eta * eta * (1.0f - dDotn * dDotn);
+	if (k <= 0.0f) return reflect(dir, n, dndx, dndy);  //Total internal reflection
+
+	float gamma = eta * dDotn + sqrt(k);
+	float dGamma = eta + eta * eta * dDotn / sqrt(k);
+	float dDndx = glm::dot(dDdx, n) + glm::dot(dir, dndx);
+	float dDndy = glm::dot(dDdy, n) + glm::dot(dir, dndy);
+	diff.dDdx = eta * dDdx - (gamma * dndx + dGamma * dDndx * n);
+	diff.dDdy = eta * dDdy - (gamma * dndy + dGamma * dDndy * n);
+	return diff;
+}
+
+/*
+ * Differentials of a direction dir scattered by a lobe spread radians wide,
+ * such as a diffuse bounce. The incoming direction says nothing about where
+ * the ray goes, so the footprint keeps its size where it leaves and widens
+ * by spread per unit distance after, across two axes perpendicular to dir.
+ */
+RayDifferential RayDifferential::scatter(glm::vec3 dir, float spread) const {
+	RayDifferential diff = *this;
+	glm::vec3 axis = fabs(dir.x) > 0.9f ? glm::vec3(0, 1, 0) : glm::vec3(1, 0, 0);
+	glm::vec3 t = glm::normalize(glm::cross(dir, axis));
+	diff.dDdx = spread * t;
+	diff.dDdy = spread * glm::cross(dir, t);
+	return diff;
+}
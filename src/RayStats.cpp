@@ -0,0 +1,45 @@
+#include "RayStats.h"
+#include <iostream>
+using namespace std;
+
+void RayStats::add(const RayStats& other) {
+	primaryRays += other.primaryRays;
+	shadowRays += other.shadowRays;
+	secondaryRays += other.secondaryRays;
+	occludedShadowRays += other.occludedShadowRays;
+	shadingPoints += other.shadingPoints;
+	areaLightTests += other.areaLightTests;
+	probeShadowRays += other.probeShadowRays;
+	penumbraShadowRays += other.penumbraShadowRays;
+	nodeVisits += other.nodeVisits;
+	primitiveTests += other.primitiveTests;
+	for (int i = 0; i < BOUNCE_DEPTH_BINS; i++) {
+		bounceDepth[i] += other.bounceDepth[i];
+	}
+}
+
+void RayStats::print() const {
+#ifdef RAY_STATS
+	uint64_t rays = totalRays();
+	cout << "Rays per Frame: " << rays << " (primary " << primaryRays << ", shadow " << shadowRays
+		 << ", secondary " << secondaryRays << ")" << endl;
+	cout << "Total Intersection Tests per Frame: " << intersections() << " (BVH nodes " << nodeVisits
+		 << ", objects " << primitiveTests << ")" << endl;
+	if (rays > 0) {
+		cout << "Average Intersection Tests per Ray per Frame: " << static_cast<float>(intersections()) / rays << endl;
+	}
+	cout << "Shadow Rays Occluded: " << occlusionRate() * 100.0f << "%" << endl;
+	cout << "Shadow Rays per Shading Point: " << shadowRaysPerPoint() << " (" << shadingPoints << " points)" << endl;
+	if (areaLightTests > 0) {
+		cout << "Soft Shadow Rays: " << probeShadowRays << " probes, " << penumbraShadowRays << " in penumbrae ("
+			 << static_cast<float>(probeShadowRays + penumbraShadowRays) / areaLightTests << " per test)" << endl;
+	}
+	cout << "Rays per Bounce Depth:";
+	for (int i = 0; i < BOUNCE_DEPTH_BINS; i++) {
+		if (bounceDepth[i] > 0) cout << " " << i << (i == BOUNCE_DEPTH_BINS - 1 ? "+" : "") << ":" << bounceDepth[i];
+	}
+	cout << endl;
+#else
+	cout << "Ray statistics are disabled, rebuild with -DRAY_STATS=ON" << endl;
+#endif
+}
@@ -12,163 +12,33 @@
 #endif
 
 #include <iostream>
-#include <mutex>
-#include <thread>
 #include <cmath>
 #include <sys/time.h>
-#include <vector>
 #include <glm/glm.hpp>
 #include <GL/freeglut.h>
-#include "FilePath.h"
-#include "SceneObject.h"
-#include "Plane.h"
-#include "Cylinder.h"
-#include "Cone.h"
-#include "Sphere.h"
-#include "RayBatchFactory.h"
-#include "Ray.h"
-#include "BVH.h"
+#include "Scene.h"
+#include "Renderer.h"
+#include "TextureCache.h"
+#include "ImageWriter.h"
+#include "Profiler.h"
+#include "Config.h"
 using namespace std;
 
-const int NUM_THREADS = 25;
-bool ENABLE_AA = true;
-bool ENABLE_BVH = false;
-bool PRINT_RAY_DEBUG = false; // enabling this will increase frame draw time significantly due to thread synchronization
 bool PRINT_FRAME_TIME = false;
-const float EDIST = 25.0;
-const int NUMDIV = 800;
-const long TOTAL_RAYS = NUMDIV * NUMDIV;
-const int MAX_STEPS = 10;
-const float XMIN = -10.0;
-const float XMAX = 10.0;
-const float YMIN = -10.0;
-const float YMAX = 10.0;
-const float cellX = (XMAX - XMIN) / NUMDIV;  //cell width
-const float cellY = (YMAX - YMIN) / NUMDIV;  //cell height
 
 int frameCount = 0;
 float frameTime = 0.0f;
 struct timeval lastTime;
 
-std::vector<int> numRayIntersections;
-
-std::mutex numRayIntersectionsMutex;
-
-std::vector<SceneObject*> sceneObjects;
-BVH *bvh;
-
-int raysPerThread = TOTAL_RAYS / NUM_THREADS;
-std::thread threads[NUM_THREADS];
-RayBatches *rayBatches;
+Scene scene;
+Renderer *renderer;
+TextureCache textureCache;
 
 // Function to calculate time difference in milliseconds
 float getTimeDifference(struct timeval *start, struct timeval *end) {
     return (end->tv_sec - start->tv_sec) * 1000.0f + (end->tv_usec - start->tv_usec) / 1000.0f;
 }
 
-//---The most important function in a ray tracer! ---------------------------------- 
-//   Computes the colour value obtained by tracing a ray and finding its 
-//     closest point of intersection with objects in the scene.
-//----------------------------------------------------------------------------------
-glm::vec3 trace(Ray ray, int eta_1, int step) {
-	glm::vec3 backgroundCol(0);						//Background colour = (0,0,0)
-	glm::vec3 lightPos(10, 30, -3);					//Light's position
-	glm::vec3 color(0);
-	glm::vec3 shadowColor(0);
-	glm::vec3 reflectedColor(0);
-	glm::vec3 transmissiveColor(0);
-
-	SceneObject* obj;
-
-	bool isShadow = false;
-	int numIntersections = 0;
-
-	//If number of objects in scene is greater than threshold, 
-	// use BVH to find closest intersection instead of linear search
-	if(ENABLE_BVH)
-		numIntersections += ray.closestPt(*bvh);
-	else
-    	numIntersections += ray.closestPt(sceneObjects);
-    if(ray.index == -1) return backgroundCol;		//no intersection
-	obj = sceneObjects[ray.index];					//object on which the closest point of intersection is found
-
-	//Object's colour
-	LightingResult result = obj->lighting(lightPos, -ray.dir, ray.hit);
-	color = result.ambient + result.diffuse;
-
-	// Shadow calculation
-	// OK so the current problem is that the shadow ray is only intersecting the first surface it contacts with
-	// regardless of transparency whereas if an object is transparent the shadow ray should be attenuated and then
-	// continue to the next object and so on until it reaches the light source or is stopped by a completely opaque object
-	// SO change this to recursivey trace the shadow ray until it reaches the light source or is stopped by an opaque object
-	// or the maximum number of steps is reached
-	// Because shadows are subtractive, tracing in either direction would yield the same color value hence we can start the shadow
-	// color as the light source's color and attenuate it as we go along so the final ray color as it has a clean shot to the light
-	// is the shadow color
-	
-	glm::vec3 lightVec = lightPos - ray.hit;
-	Ray shadowRay(ray.hit, lightVec);
-	if(ENABLE_BVH)
-		numIntersections += shadowRay.closestPt(*bvh);
-	else
-    	numIntersections += shadowRay.closestPt(sceneObjects);
-
-	if(shadowRay.index > -1 && shadowRay.dist < glm::length(lightVec)) {
-		isShadow = true;
-		SceneObject* shadowObj = sceneObjects[shadowRay.index];
-		if(shadowObj->isTransparent() && !(shadowRay.index == ray.index)) {
-			float shadowAlpha = (1 - shadowObj->getTransparencyCoeff());
-			color = (0.2f + 0.7f * shadowAlpha) * color;
-		} else if(shadowObj->isRefractive() && !(shadowRay.index == ray.index)){
-			float shadowAlpha = (1 - shadowObj->getRefractionCoeff());
-			color = (0.2f + 0.7f * shadowAlpha) * color;
-		} else {
-			color = result.ambient;
-		}
-	}
-
-	if (obj->isReflective() && step < MAX_STEPS) {
-		// Reflection calculation
-		float rho = obj->getReflectionCoeff();
-		glm::vec3 normalVec = obj->normal(ray.hit);
-		if(glm::dot(ray.dir, normalVec) < 0.0f){
-			glm::vec3 reflectedDir = glm::reflect(ray.dir, normalVec);
-			Ray reflectedRay(ray.hit, reflectedDir);
-			reflectedColor = trace(reflectedRay, obj->getRefractiveIndex(), step + 1);
-			color = (1-rho) * color + rho * reflectedColor;
-		}
-	}
-
-	if(obj->isTransparent() && step < MAX_STEPS) {
-		// Transparency calculation
-		float alpha = obj->getTransparencyCoeff();
-		Ray transparencyRay(ray.hit, ray.dir);
-		transmissiveColor = trace(transparencyRay, obj->getRefractiveIndex(), step + 1);
-		color = (alpha * color) + ((1 - alpha) * transmissiveColor);
-	} else if(obj->isRefractive() && step < MAX_STEPS) {
-		// Refraction calculation
-		float alpha = obj->getRefractionCoeff();
-		float eta_2 = obj->getRefractiveIndex();
-		glm::vec3 n = obj->normal(ray.hit);
-		(glm::dot(ray.dir, n) > 0) ? n = -n : n = n;
-		glm::vec3 g = glm::refract(glm::normalize(ray.dir), n, eta_1 / eta_2);
-		Ray refractedRay(ray.hit, g);
-		transmissiveColor = trace(refractedRay, eta_2, step + 1);
-		color = (alpha * color) + ((1 - alpha) * transmissiveColor);
-	}
-
-	if(PRINT_RAY_DEBUG){
-		// Lock the mutex before accessing the shared data
-		std::lock_guard<std::mutex> lock(numRayIntersectionsMutex);
-		numRayIntersections.push_back(numIntersections);
-	}
-
-	// don't add specular component if object is in shadow
-	// adding it after all other calculatinos ensures it's brightness 
-	// is preseved through transparency and reflection calculations
-	return (isShadow) ? color : color + result.specular;
-}
-
 void printFrameTime() {
 	// Increment frame count
     frameCount++;
@@ -188,122 +58,48 @@ void printFrameTime() {
     }
 }
 
-void printRayDebug() {
-	// Calculate average number of ray intersections
-	int totalIntersections = 0;
-	for (int i = 0; i < numRayIntersections.size(); i++) {
-		totalIntersections += numRayIntersections[i];
-	}
-	cout << "Total Intersection Tests per Frame: " << totalIntersections << endl;
-	cout << "Average Intersection Tests per Ray per Frame: " << static_cast<float>(totalIntersections / numRayIntersections.size()) << endl;
-	numRayIntersections.clear();
-}
-
-void rayTraceThread(RayWrapper *rays, size_t numRays) {
-	const float offset = 0.025f;
-	for(int i = 0; i < numRays; i++) {
-		if(ENABLE_AA){
-			glm::vec3 col(0.0f);
-			for(float dx = -0.5f; dx <= 0.5f; dx += 1.0f) {
-				for(float dy = -0.5f; dy <= 0.5f; dy += 1.0f) {
-					glm::vec3 perturbation(dx * cellX * offset, dy * cellY * offset, 0.0f);
-					glm::vec3 aaDir = rays[i].ray->dir + perturbation;
-					Ray ray(rays[i].ray->p0, aaDir);
-					col += trace(ray, 1, 1);
-				}
-			}
-			rays[i].col = col / 4.0f;
-		}
-		else {
-			rays[i].col = trace(*(rays[i].ray), 1, 1); //Trace the primary ray and get the colour value
-		}
-	}
-	return;
-}
-
 //---The main display module -----------------------------------------------------------
 // In a ray tracing application, it just displays the ray traced image by drawing
 // each cell as a quad.
 //---------------------------------------------------------------------------------------
 void display() {
-	float xp, yp;  //grid point
-	glm::vec3 eye(0., 0., 0.);
+	RenderSettings& settings = renderer->getSettings();
+
+	ProfileScope frameScope("frame");
 
 	glClear(GL_COLOR_BUFFER_BIT);
     glMatrixMode(GL_MODELVIEW);
     glLoadIdentity();
 
-	for (int i = 0; i < NUMDIV; i++)	//Scan every cell of the image plane
-	{
-		xp = XMIN + i * cellX;
-		for (int j = 0; j < NUMDIV; j++)
-		{
-			yp = YMIN + j * cellY;
+	renderer->render();
 
-			glm::vec3 dir(xp + 0.5 * cellX, yp + 0.5 * cellY, -EDIST);	//direction of the primary ray
-
-			RayWrapper* wrappedRay = rayBatches[(i * NUMDIV + j) / raysPerThread].rays + ((i * NUMDIV + j) % raysPerThread);
-
-			wrappedRay->xp = xp;
-			wrappedRay->yp = yp;
-			wrappedRay->ray = new Ray(eye, dir);
+	{
+		ProfileScope submitScope("GL submit");
+		glBegin(GL_QUADS);  //Each cell is a tiny quad, one unit across.
+
+		for (int j = 0; j < renderer->getHeight(); j++) {
+			for (int i = 0; i < renderer->getWidth(); i++) {
+				const glm::vec3& col = renderer->getPixel(i, j);
+				glColor3f(col.r, col.g, col.b);
+				glVertex2i(i, j);
+				glVertex2i(i + 1, j);
+				glVertex2i(i + 1, j + 1);
+				glVertex2i(i, j + 1);
+			}
 		}
-	}
 
-	for (size_t i = 0; i < NUM_THREADS; i++) {
-		threads[i] = std::thread(rayTraceThread, rayBatches[i].rays, rayBatches[i].numRays);
-	}
-
-	glBegin(GL_QUADS);  //Each cell is a tiny quad.
-
-	for (size_t i = 0; i < NUM_THREADS; i++) {
-		threads[i].join();
-		for (int j = 0; j < rayBatches[i].numRays; j++){
-			glColor3f(rayBatches[i].rays[j].col.r, rayBatches[i].rays[j].col.g, rayBatches[i].rays[j].col.b);
-			glVertex2f(rayBatches[i].rays[j].xp, rayBatches[i].rays[j].yp);
-			glVertex2f(rayBatches[i].rays[j].xp + cellX, rayBatches[i].rays[j].yp);
-			glVertex2f(rayBatches[i].rays[j].xp + cellX, rayBatches[i].rays[j].yp + cellY);
-			glVertex2f(rayBatches[i].rays[j].xp, rayBatches[i].rays[j].yp + cellY);
-		}
+		glEnd();
+		glutSwapBuffers();
 	}
 
-	glEnd();
-    glutSwapBuffers();
-
 	if(PRINT_FRAME_TIME) printFrameTime();
-	if(PRINT_RAY_DEBUG) printRayDebug();
-}
-
-void drawCircles(const int numSpheres, const bool useRandomPlacement) {
-	for(int i = 0; i < numSpheres; i++) {
-		if(useRandomPlacement) {
-			float x = (rand() % 20) - 10;
-			float y = (rand() % 20) - 10;
-			float z = (rand() % 20) - 10;
-			float r = static_cast<float>(rand()) / static_cast<float>(RAND_MAX) * 5.0f;
-			Sphere *sphere = new Sphere(glm::vec3(x, y, -70 + z), r);
-			sphere->setId(i);
-			sphere->setColor(glm::vec3((rand() % 100) / 100.0f, (rand() % 100) / 100.0f, (rand() % 100) / 100.0f));
-			sceneObjects.push_back(sphere);
-		}else{
-			const int rows = ceil(sqrt(numSpheres));
-			const int cols = floor(sqrt(numSpheres));
-			const float xSpacing = (XMAX - XMIN) / (cols + 1);
-			const float ySpacing = (YMAX - YMIN) / (rows + 1);
-
-			//space spheres out evenly and set size so all are visible
-			int rowIndex = i / cols;
-    		int colIndex = i % cols;
-
-			float x = XMIN + (colIndex + 1) * xSpacing;
-    		float y = YMIN + (rowIndex + 1) * ySpacing;
-			float z = -40;
-			float r = 0.5f;
-			Sphere *sphere = new Sphere(glm::vec3(x, y, z), r);
-			sphere->setId(i);
-			sphere->setColor(glm::vec3((rand() % 100) / 100.0f, (rand() % 100) / 100.0f, (rand() % 100) / 100.0f));
-			sceneObjects.push_back(sphere);
-		}
+	if(settings.printRayDebug) renderer->printRayDebug();
+	if(settings.recordHeatmaps) {
+		// heatmaps are recorded for a single frame and saved next to the image
+		writeBMP("frame.bmp", renderer->getWidth(), renderer->getHeight(), renderer->getFramebuffer());
+		renderer->getHeatmaps().write("frame");
+		settings.recordHeatmaps = false;
+		cout << "Saved frame.bmp and its heatmaps" << endl;
 	}
 }
 
@@ -313,143 +109,77 @@ void drawCircles(const int numSpheres, const bool useRandomPlacement) {
 //   It also initializes the OpenGL 2D orthographc projection matrix for drawing the
 //     the ray traced image.
 //----------------------------------------------------------------------------------
-void initialize() {
-	rayBatches = createRayBatches(NUMDIV, NUM_THREADS);
-	if (rayBatches == nullptr) {
-		cout << "Unable to allocate memory for RayBatches array. Exiting..." << endl;
-  		exit(1);
-	}
+void initialize(const RenderSettings& config) {
+	renderer = new Renderer(&scene, config);
 
     glMatrixMode(GL_PROJECTION);
-    gluOrtho2D(XMIN, XMAX, YMIN, YMAX);
+    gluOrtho2D(0, config.width, 0, config.height);	//one unit per cell
 
     glClearColor(0, 0, 0, 1);
 
-	// Objects
-	Sphere *sphere1 = new Sphere(glm::vec3(-15.0, -5.0, -60.0), 5.0);
-	sphere1->setColor(glm::vec3(0, 0, 1));   //Set colour to blue
-	sphere1->setReflectivity(true, 0.5);
-	sceneObjects.push_back(sphere1);		 //Add sphere to scene objects
-
-	Sphere *sphere2 = new Sphere(glm::vec3(-5, 7, -60), 3.0);
-	sphere2->setTexture(TextureBMP(getFilePath("Earth.bmp").c_str()));
-	sphere2->setShininess(50);
-	sceneObjects.push_back(sphere2);		 //Add sphere to scene objects
-
-	Sphere *sphere3 = new Sphere(glm::vec3(15, -5.0, -60), 5.0);
-	sphere3->setColor(glm::vec3(1, 0, 0));   //Set colour to red
-	sphere3->setShininess(100);
-	sphere3->setTransparency(true, 0.3);
-	sceneObjects.push_back(sphere3);		 //Add sphere to scene objects
-
-	Sphere *sphere4 = new Sphere(glm::vec3(0, -5.0, -60), 5.0);
-	sphere4->setColor(glm::vec3(0, 1, 0));   //Set colour to green
-	sphere4->setSpecularity(false);
-	sphere4->setRefractivity(true, 0.1, 1.1);
-	sceneObjects.push_back(sphere4);		 //Add sphere to scene objects
-
-	Cylinder *cylinder = new Cylinder(glm::vec3(6.5, -15, -50), 2, 10);
-	cylinder->setColor(glm::vec3(0, 1, 1));
-	cylinder->setReflectivity(true, 0.7);
-	sceneObjects.push_back(cylinder);
-
-	Cone *cone = new Cone(glm::vec3(-6.5, -5, -50), 5, 10);
-	cone->setColor(glm::vec3(1, 0, 1));
-	sceneObjects.push_back(cone);
-
-	// Walls
-	Plane *floor = new Plane(glm::vec3(-40., -15, 20), //Point A
-							  glm::vec3(40., -15, 20), //Point B
-							  glm::vec3(40., -15, -200), //Point C
-							  glm::vec3(-40., -15, -200)); //Point D
-	floor->setColor(glm::vec3(0.8, 0.8, 0));
-	floor->setSpecularity(false);
-	floor->setStripe(true, 5, glm::vec3(0, 0, 1), {glm::vec3(0, 1, 0), glm::vec3(1, 1, 0.5)});
-	sceneObjects.push_back(floor);
-
-	Plane *backWall = new Plane(glm::vec3(-40., -15, -200), //Point A
-								glm::vec3(40., -15, -200), //Point B
-								glm::vec3(40., 40, -200), //Point C
-								glm::vec3(-40., 40, -200)); //Point D
-	backWall->setColor(glm::vec3(0.5, 0.5, 0.5));
-	backWall->setSpecularity(false);
-	backWall->setReflectivity(true, 1.);
-	sceneObjects.push_back(backWall);
-
-	Plane *ceiling = new Plane(glm::vec3(-50, 40, 20), //Point A
-							   glm::vec3(-50, 40, -200), //Point B
-							   glm::vec3(50, 40, -200), //Point C
-							   glm::vec3(50, 40, 20)); //Point D
-	ceiling->setColor(glm::vec3(0.8, 0.8, 0.8));
-	ceiling->setSpecularity(false);
-	ceiling->setCheckered(true, 2, glm::vec3(0, 0, 0), glm::vec3(1, 1, 1));
-	sceneObjects.push_back(ceiling);
-
-	Plane *leftWall = new Plane(glm::vec3(-40., -15, 20), //Point A
-								glm::vec3(-40., -15, -200), //Point B
-								glm::vec3(-40., 40, -200), //Point C
-								glm::vec3(-40., 40, 20)); //Point D
-	leftWall->setColor(glm::vec3(1, 0, 0));
-	leftWall->setSpecularity(false);
-	sceneObjects.push_back(leftWall);
-
-	Plane *rightWall = new Plane(glm::vec3(40., -15, 20), //Point A
-								glm::vec3(40., 40, 20), //Point B
-								glm::vec3(40., 40, -200), //Point C
-								glm::vec3(40., -15, -200)); //Point D
-	rightWall->setColor(glm::vec3(0, 0.5, 1));
-	rightWall->setSpecularity(false);
-	sceneObjects.push_back(rightWall);
-
-	Plane *frontWall = new Plane(glm::vec3(-40., -15, 20), //Point A
-								glm::vec3(-40., 40, 20), //Point B
-								glm::vec3(40., 40, 20), //Point C
-								glm::vec3(40., -15, 20)); //Point D
-	frontWall->setColor(glm::vec3(0.5, 0.5, 0.5));
-	frontWall->setSpecularity(false);
-	frontWall->setReflectivity(true, 1.);
-	sceneObjects.push_back(frontWall);
-
-	bvh = new BVH(&sceneObjects);
+	buildDemoScene(scene, textureCache);
+	scene.build();
 }
 
-void keyHandler(unsigned char key, int x, int y){
+void keyHandler(unsigned char key, int, int){
+	RenderSettings& settings = renderer->getSettings();
     if(key == 27){
-		void freeRayBatches(RayBatches* rayBatches);
+		delete renderer;
 		exit(0);
 	} else if (key == 'a'){
-		ENABLE_AA = !ENABLE_AA;
-		cout << "Anti-aliasing: " << (ENABLE_AA ? "Enabled" : "Disabled") << endl;
+		settings.enableAA = !settings.enableAA;
+		cout << "Anti-aliasing: " << (settings.enableAA ? "Enabled" : "Disabled") << endl;
 	} else if (key == 'b'){
-		ENABLE_BVH = !ENABLE_BVH;
-		cout << "Bounding Volume Hierarchy: " << (ENABLE_BVH ? "Enabled" : "Disabled") << endl;
+		settings.enableBVH = !settings.enableBVH;
+		cout << "Bounding Volume Hierarchy: " << (settings.enableBVH ? "Enabled" : "Disabled") << endl;
 	} else if (key == 'd'){
-		PRINT_RAY_DEBUG = !PRINT_RAY_DEBUG;
-		cout << "Ray Debug: " << (PRINT_RAY_DEBUG ? "Enabled" : "Disabled") << endl;
+		settings.printRayDebug = !settings.printRayDebug;
+		cout << "Ray Debug: " << (settings.printRayDebug ? "Enabled" : "Disabled") << endl;
 	} else if (key == 't'){
 		PRINT_FRAME_TIME = !PRINT_FRAME_TIME;
 		gettimeofday(&lastTime, NULL);
 		cout << "Frame Time Debug: " << (PRINT_FRAME_TIME ? "Enabled" : "Disabled") << endl;
+	} else if (key == 'h'){
+		settings.recordHeatmaps = true;
+	} else if (key == 'p'){
+		if(Profiler::isRunning()) {
+			Profiler::stop("trace.json");
+		} else {
+			Profiler::start();
+			cout << "Capturing trace, press 'p' again to save it to trace.json" << endl;
+		}
 	}
 }
 
 int main(int argc, char *argv[]) {
     glutInit(&argc, argv);
+
+	RenderSettings config;
+	vector<string> unparsed;
+	if(!parseSettings(argc, argv, config, unparsed)) return 1;
+	if(!unparsed.empty()) {
+		cout << "Usage: RayTracer [render settings]" << endl;
+		printSettingsUsage();
+		return unparsed[0] == "--help" ? 0 : 1;
+	}
+
     glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGB);
-    glutInitWindowSize(800, 800);
+    glutInitWindowSize(config.width, config.height);
     glutInitWindowPosition(20, 20);
     glutCreateWindow("Raytracing");
 
 	glutKeyboardFunc(keyHandler);
     glutDisplayFunc(display);
 	glutIdleFunc(display);
-    initialize();
+    initialize(config);
 
 	cout << "Press ESC to exit" << endl;
-	cout << "Press 'a' to toggle anti-aliasing, status: " << (ENABLE_AA ? "Enabled" : "Disabled") << endl;
-	cout << "Press 'b' to toggle bounding volume hierarchy, status: " << (ENABLE_BVH ? "Enabled" : "Disabled") << endl;
-	cout << "Press 'd' to toggle ray debug, status: " << (PRINT_RAY_DEBUG ? "Enabled" : "Disabled") << endl;
+	cout << "Press 'a' to toggle anti-aliasing, status: " << (renderer->getSettings().enableAA ? "Enabled" : "Disabled") << endl;
+	cout << "Press 'b' to toggle bounding volume hierarchy, status: " << (renderer->getSettings().enableBVH ? "Enabled" : "Disabled") << endl;
+	cout << "Press 'd' to toggle ray debug, status: " << (renderer->getSettings().printRayDebug ? "Enabled" : "Disabled") << endl;
 	cout << "Press 't' to toggle frame time debug, status: " << (PRINT_FRAME_TIME ? "Enabled" : "Disabled") << endl;
+	cout << "Press 'h' to save the next frame with per-pixel cost heatmaps" << endl;
+	cout << "Press 'p' to start and stop capturing a trace of each frame's phases" << endl;
 
     glutMainLoop();
     return 0;
@@ -0,0 +1,608 @@
+#include "RenderService.h"
+#include <map>
+#include <mutex>
+#include <memory>
+#include <thread>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cerrno>
+#include <cstring>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+#include <condition_variable>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include "Scene.h"
+#include "Config.h"
+#include "Socket.h"
+#include "TextureCache.h"
+using namespace std;
+
+// Messages are framed as described in Socket.h
+enum ServiceMessageType : uint32_t {
+    MSG_SUBMIT = 16,    // client: priority, then the scene name, a newline and the settings as config lines
+    MSG_ACCEPTED = 17,  // service: job number
+    MSG_REJECTED = 18,  // service: job number (0 if it was never queued), then the reason
+    MSG_IMAGE = 19      // service: job number, width, height, then RGB of every cell, row by row
+};
+
+const uint64_t MAX_IMAGE_PAYLOAD = UINT32_MAX;
+
+static volatile sig_atomic_t stopRequested = 0;
+static int signalWakeFd = -1;
+
+static void requestStop(int) {
+    stopRequested = 1;
+    if (signalWakeFd >= 0) {
+        ssize_t n = write(signalWakeFd, "s", 1);
+        (void)n;
+    }
+}
+
+static double elapsedMs(chrono::steady_clock::time_point from, chrono::steady_clock::time_point to) {
+    return chrono::duration<double, milli>(to - from).count();
+}
+
+namespace {
+
+struct ResidentScene {
+    Scene scene;
+    bool ready = false;         // guarded by the service's mutex, like everything below
+    bool failed = false;
+};
+
+struct Job {
+    int id;
+    int client;
+    int priority;
+    string sceneName;
+    RenderSettings settings;
+    ResidentScene *scene;
+    unique_ptr<Renderer> renderer;
+    unique_ptr<Denoiser> denoiser;  // once the frame is traced, if the settings ask for it
+    int numTasks = 0;           // the frame's tiles, then the bands of each of the denoiser's passes
+    int nextTask = 0;
+    int tasksLeft = 0;
+    int inFlight = 0;           // tasks being run
+    bool cancelled = false;
+    bool failed = false;
+    chrono::steady_clock::time_point submitted, started, finished;
+};
+
+struct Client {
+    int id;
+    int fd;
+    string input;               // what has arrived of messages not yet handled
+    string output;              // messages waiting for the socket to take them, from sent on
+    size_t sent = 0;
+};
+
+class RenderServer {
+    public:
+        RenderServer(const ServiceSettings& service) : service(service) {}
+        ~RenderServer();
+
+        bool listen(const string& address);
+        void run();
+    private:
+        void acceptClient();
+        bool receive(Client& client);
+        bool submit(Client& client, const string& payload);
+        void dropClient(size_t index);
+        void queueMessage(Client& client, uint32_t type, const string& payload);
+        bool flushOutput(Client& client);
+        void sendFinished();
+        void wake();
+
+        ResidentScene* residentScene(const string& name);
+        void startJobs();
+        Job* nextTaskJob();
+        void retireJob(Job* job);
+        void loadScenes();
+        void traceWorker(int worker);
+
+        ServiceSettings service;
+        int listenFd = -1;
+        string unixPath;                //Removed again when the service closes
+        int wakeFds[2] = { -1, -1 };    //Written to wake the poll loop when jobs finish
+        vector<Client> clients;
+        int nextClient = 1;
+        TextureCache textureCache;      //Shared by every resident scene
+        vector<RayStats> threadStats;
+
+        mutex jobMutex;
+        condition_variable tasksQueued;
+        condition_variable scenesQueued;
+        map<string, unique_ptr<ResidentScene>> scenes;
+        vector<string> loadQueue;
+        vector<unique_ptr<Job>> queued;     // in order of submission
+        vector<unique_ptr<Job>> active;
+        vector<unique_ptr<Job>> finished;   // waiting to be sent back
+        int nextJob = 1;
+        bool stopping = false;
+};
+
+RenderServer::~RenderServer() {
+    for (Client& c : clients) close(c.fd);
+    if (listenFd >= 0) close(listenFd);
+    if (!unixPath.empty()) unlink(unixPath.c_str());
+    for (int fd : wakeFds) {
+        if (fd >= 0) close(fd);
+    }
+}
+
+bool RenderServer::listen(const string& address) {
+    listenFd = openSocket(address, true, unixPath);
+    if (listenFd < 0) {
+        cout << "Error :: Unable to listen on " << address << ": " << strerror(errno) << endl;
+        return false;
+    }
+    if (pipe(wakeFds) != 0) {
+        cout << "Error :: Unable to create a pipe: " << strerror(errno) << endl;
+        return false;
+    }
+    for (int fd : wakeFds) fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    cout << "Listening for render jobs on " << address << endl;
+    return true;
+}
+
+void RenderServer::wake() {
+    ssize_t n = write(wakeFds[1], "w", 1);     // a full pipe will wake it anyway
+    (void)n;
+}
+
+//---Scheduling, always with jobMutex held ------------------------------------------
+
+// The scene called name, queued to be built if this is the first time it is asked for
+ResidentScene* RenderServer::residentScene(const string& name) {
+    unique_ptr<ResidentScene>& scene = scenes[name];
+    if (!scene) {
+        scene.reset(new ResidentScene());
+        loadQueue.push_back(name);
+        scenesQueued.notify_one();
+    }
+    return scene.get();
+}
+
+// Moves queued jobs whose scene is built into free slots, highest priority first
+void RenderServer::startJobs() {
+    while ((int)active.size() < service.maxActiveJobs) {
+        size_t best = queued.size();
+        for (size_t i = 0; i < queued.size(); i++) {
+            const ResidentScene *scene = queued[i]->scene;
+            if (!scene->ready && !scene->failed) continue;
+            if (best == queued.size() || queued[i]->priority > queued[best]->priority) best = i;
+        }
+        if (best == queued.size()) break;
+
+        unique_ptr<Job> job = move(queued[best]);
+        queued.erase(queued.begin() + best);
+        job->started = chrono::steady_clock::now();
+        if (job->scene->failed) {
+            job->failed = true;
+            job->finished = job->started;
+            finished.push_back(move(job));
+            wake();
+            continue;
+        }
+        job->renderer.reset(new Renderer(&job->scene->scene, job->settings));
+        job->renderer->beginFrame();
+        job->numTasks = job->tasksLeft = job->renderer->getNumTiles();
+        active.push_back(move(job));
+    }
+    tasksQueued.notify_all();
+}
+
+// The highest priority active job with a task to hand out and a thread to spare, or null
+Job* RenderServer::nextTaskJob() {
+    Job *best = nullptr;
+    for (unique_ptr<Job>& job : active) {
+        if (job->cancelled || job->nextTask == job->numTasks || job->inFlight >= job->settings.numThreads) continue;
+        if (!best || job->priority > best->priority || (job->priority == best->priority && job->id < best->id)) {
+            best = job.get();
+        }
+    }
+    return best;
+}
+
+// Frees the slot of a job that is finished or cancelled with no tasks still being run
+void RenderServer::retireJob(Job* job) {
+    auto it = find_if(active.begin(), active.end(), [&](const unique_ptr<Job>& j) { return j.get() == job; });
+    unique_ptr<Job> retired = move(*it);
+    active.erase(it);
+    if (!retired->cancelled) {
+        retired->finished = chrono::steady_clock::now();
+        finished.push_back(move(retired));
+        wake();
+    }
+    startJobs();
+}
+
+//---Threads ---------------------------------------------------------------------------
+
+/*
+ * Builds scenes one at a time on a thread of their own, so the poll loop and
+ * the jobs being traced carry on meanwhile; one at a time since scenes with
+ * random placement share rand().
+ */
+void RenderServer::loadScenes() {
+    while (true) {
+        string name;
+        ResidentScene *scene;
+        {
+            unique_lock<mutex> lock(jobMutex);
+            scenesQueued.wait(lock, [&] { return stopping || !loadQueue.empty(); });
+            if (stopping) return;
+            name = loadQueue.front();
+            loadQueue.erase(loadQueue.begin());
+            scene = scenes[name].get();
+        }
+        auto start = chrono::steady_clock::now();
+        bool ok = buildScene(name, scene->scene, textureCache);
+        if (ok) scene->scene.build();
+        if (ok) printf("Built %s in %.1f ms\n", name.c_str(), elapsedMs(start, chrono::steady_clock::now()));
+        else cout << "Error :: Unable to build " << name << endl;
+        fflush(stdout);
+
+        lock_guard<mutex> lock(jobMutex);
+        scene->ready = ok;
+        scene->failed = !ok;
+        startJobs();
+    }
+}
+
+/*
+ * Moves a job whose tasks are all done on to its next stage, returning false
+ * once it is finished: the traced frame is denoised one pass at a time, every
+ * pass's bands run on the pool like the tiles were.
+ */
+bool nextStage(Job& job) {
+    if (!job.settings.denoise) return false;
+    if (!job.denoiser) {
+        job.denoiser.reset(new Denoiser(job.renderer->getFramebuffer(), job.renderer->getAuxBuffers()));
+    } else if (!job.denoiser->nextPass()) {
+        job.renderer->finishDenoise(*job.denoiser);
+        job.denoiser.reset();
+        return false;
+    }
+    return true;
+}
+
+void RenderServer::traceWorker(int worker) {
+    vector<float> scratch;      // for the denoiser's bands
+    while (true) {
+        Job *job = nullptr;
+        int task;
+        {
+            unique_lock<mutex> lock(jobMutex);
+            tasksQueued.wait(lock, [&] { return stopping || (job = nextTaskJob()) != nullptr; });
+            if (stopping) return;
+            task = job->nextTask++;
+            job->inFlight++;
+        }
+        if (job->denoiser) job->denoiser->filterBand(task, scratch);
+        else job->renderer->renderTile(task, threadStats[worker]);
+
+        unique_lock<mutex> lock(jobMutex);
+        job->tasksLeft--;
+        // the thread finishing a stage's last task starts the next; there is nothing to hand out meanwhile
+        if (job->tasksLeft == 0 && !job->cancelled) {
+            lock.unlock();
+            bool more = nextStage(*job);
+            lock.lock();
+            if (more) {
+                job->nextTask = 0;
+                job->numTasks = job->tasksLeft = job->denoiser->getNumBands();
+                tasksQueued.notify_all();
+            }
+        }
+        job->inFlight--;
+        if (job->tasksLeft == 0 || (job->cancelled && job->inFlight == 0)) retireJob(job);
+        else tasksQueued.notify_one();   // the job may have been at its thread limit
+    }
+}
+
+//---Clients ---------------------------------------------------------------------------
+
+void RenderServer::acceptClient() {
+    int fd = accept(listenFd, nullptr, nullptr);
+    if (fd < 0) return;
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);    // a client that stalls mid-message holds up nothing
+    clients.push_back({ nextClient++, fd, string(), string(), 0 });
+}
+
+// Closes the client's connection and cancels its jobs
+void RenderServer::dropClient(size_t index) {
+    const int id = clients[index].id;
+    close(clients[index].fd);
+    clients.erase(clients.begin() + index);
+
+    lock_guard<mutex> lock(jobMutex);
+    auto ofClient = [&](const unique_ptr<Job>& job) { return job->client == id; };
+    queued.erase(remove_if(queued.begin(), queued.end(), ofClient), queued.end());
+    finished.erase(remove_if(finished.begin(), finished.end(), ofClient), finished.end());
+    vector<Job*> idle;
+    for (unique_ptr<Job>& job : active) {
+        if (job->client != id) continue;
+        job->cancelled = true;
+        if (job->inFlight == 0) idle.push_back(job.get());
+    }
+    for (Job *job : idle) retireJob(job);
+}
+
+/*
+ * Reads what the client has sent without blocking and handles each message
+ * once all of it has arrived. Returns false if the client should be dropped.
+ */
+bool RenderServer::receive(Client& client) {
+    // one read a wakeup, so a client that keeps sending cannot keep the loop to itself
+    char buf[16384];
+    ssize_t n = recv(client.fd, buf, sizeof(buf), 0);
+    if (n < 0) return errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK;
+    if (n == 0) return false;
+    client.input.append(buf, n);
+
+    // a header announcing more than MAX_PAYLOAD drops the client before any more is buffered
+    size_t offset = 0;
+    while (client.input.size() - offset >= 8) {
+        const uint32_t type = getU32(client.input, offset);
+        const uint32_t size = getU32(client.input, offset + 4);
+        if (type != MSG_SUBMIT || size > MAX_PAYLOAD) return false;
+        if (client.input.size() - offset - 8 < size) break;
+        if (!submit(client, client.input.substr(offset + 8, size))) return false;
+        offset += 8 + size;
+    }
+    client.input.erase(0, offset);
+    return true;
+}
+
+// Queues the job of a submit message, returns false if the client should be dropped
+bool RenderServer::submit(Client& client, const string& payload) {
+    if (payload.size() < 4) return false;
+    const int priority = (int32_t)getU32(payload, 0);
+    size_t newline = payload.find('\n', 4);
+    string name = payload.substr(4, newline - 4);
+    istringstream settingsText(newline == string::npos ? "" : payload.substr(newline + 1));
+    RenderSettings settings;
+    const vector<string>& names = sceneNames();
+    string reason;
+    if (newline == string::npos || !parseConfig(settingsText, "job", settings)) {
+        reason = "invalid settings";
+    } else if (find(names.begin(), names.end(), name) == names.end()) {
+        reason = "unknown scene '" + name + "'";
+    } else if (12 + (uint64_t)settings.width * settings.height * 12 > MAX_IMAGE_PAYLOAD) {
+        reason = "the image is too large to send back";
+    }
+    settings.printRayDebug = false;
+    settings.recordHeatmaps = false;
+
+    int id = 0;
+    {
+        lock_guard<mutex> lock(jobMutex);
+        if (reason.empty() && (int)queued.size() >= service.maxQueuedJobs) reason = "the queue is full";
+        if (reason.empty()) {
+            unique_ptr<Job> job(new Job());
+            job->id = id = nextJob++;
+            job->client = client.id;
+            job->priority = priority;
+            job->sceneName = name;
+            job->settings = settings;
+            job->scene = residentScene(name);
+            job->submitted = chrono::steady_clock::now();
+            queued.push_back(move(job));
+            startJobs();
+        }
+    }
+
+    // queued ahead of the image, which goes through the same output
+    string reply;
+    putU32(reply, id);
+    if (reason.empty()) {
+        queueMessage(client, MSG_ACCEPTED, reply);
+    } else {
+        cout << "Rejected a job for " << name << ": " << reason << endl;
+        queueMessage(client, MSG_REJECTED, reply + reason);
+    }
+    return true;
+}
+
+void RenderServer::queueMessage(Client& client, uint32_t type, const string& payload) {
+    putHeader(client.output, type, payload.size());
+    client.output += payload;
+}
+
+/*
+ * Sends what the client's socket takes of its output without blocking; the
+ * rest waits for the poll loop to see the socket writable again. Returns
+ * false if the client should be dropped.
+ */
+bool RenderServer::flushOutput(Client& client) {
+    if (!sendPending(client.fd, client.output, client.sent)) return false;
+    if (client.sent == client.output.size()) {
+        string().swap(client.output);   // gives back an image's worth of memory
+        client.sent = 0;
+    }
+    return true;
+}
+
+void RenderServer::sendFinished() {
+    vector<unique_ptr<Job>> done;
+    {
+        lock_guard<mutex> lock(jobMutex);
+        done.swap(finished);
+    }
+    for (unique_ptr<Job>& job : done) {
+        auto client = find_if(clients.begin(), clients.end(), [&](const Client& c) { return c.id == job->client; });
+        if (client == clients.end()) continue;
+
+        if (job->failed) {
+            string payload;
+            putU32(payload, job->id);
+            queueMessage(*client, MSG_REJECTED, payload + "unable to build scene '" + job->sceneName + "'");
+            continue;
+        }
+        // written straight into the client's output, which the poll loop sends as the socket takes it
+        const RenderSettings& settings = job->settings;
+        const vector<glm::vec3>& framebuffer = job->renderer->getFramebuffer();
+        string& out = client->output;
+        out.reserve(out.size() + 20 + framebuffer.size() * 12);
+        putHeader(out, MSG_IMAGE, 12 + framebuffer.size() * 12);
+        putU32(out, job->id);
+        putU32(out, settings.width);
+        putU32(out, settings.height);
+        for (const glm::vec3& col : framebuffer) {
+            putFloat(out, col.r);
+            putFloat(out, col.g);
+            putFloat(out, col.b);
+        }
+        printf("Job %d: %s at %d x %d, priority %d, queued %.1f ms, traced in %.1f ms\n", job->id,
+               job->sceneName.c_str(), settings.width, settings.height, job->priority,
+               elapsedMs(job->submitted, job->started), elapsedMs(job->started, job->finished));
+        fflush(stdout);
+    }
+}
+
+/*
+ * Waits on the wake pipe, the listening socket and every client at once.
+ * Clients' jobs are queued as they arrive, and images queued for sending
+ * whenever the tracing threads wake the loop with finished jobs. Clients
+ * with output still to send are polled for writing too, so a slow reader
+ * never holds up the loop.
+ */
+void RenderServer::run() {
+    threadStats.assign(service.numThreads, RayStats());
+    vector<thread> threads;
+    for (int i = 0; i < service.numThreads; i++) threads.push_back(thread(&RenderServer::traceWorker, this, i));
+    thread loader(&RenderServer::loadScenes, this);
+    {
+        lock_guard<mutex> lock(jobMutex);
+        for (const string& name : service.preload) residentScene(name);
+    }
+
+    stopRequested = 0;
+    signalWakeFd = wakeFds[1];
+    signal(SIGINT, requestStop);
+    signal(SIGTERM, requestStop);
+
+    while (!stopRequested) {
+        vector<pollfd> fds(clients.size() + 2);
+        fds[0] = { wakeFds[0], POLLIN, 0 };
+        fds[1] = { listenFd, POLLIN, 0 };
+        for (size_t i = 0; i < clients.size(); i++) {
+            const short events = clients[i].output.empty() ? POLLIN : POLLIN | POLLOUT;
+            fds[i + 2] = { clients[i].fd, events, 0 };
+        }
+        if (poll(fds.data(), fds.size(), -1) < 0) {
+            if (errno == EINTR) continue;
+            cout << "Error :: poll failed: " << strerror(errno) << endl;
+            break;
+        }
+
+        if (fds[0].revents & POLLIN) {
+            char drain[64];
+            while (read(wakeFds[0], drain, sizeof(drain)) > 0) {}
+        }
+        // clients after the last one polled are new, there is nothing to read from them yet
+        size_t numPolled = clients.size();
+        if (fds[1].revents & POLLIN) acceptClient();
+        for (size_t i = numPolled; i > 0; i--) {
+            const short events = fds[i + 1].revents;
+            bool ok = !(events & POLLOUT) || flushOutput(clients[i - 1]);
+            if (ok && (events & ~POLLOUT)) ok = receive(clients[i - 1]);
+            if (!ok) dropClient(i - 1);
+        }
+        sendFinished();
+    }
+
+    signal(SIGINT, SIG_DFL);
+    signal(SIGTERM, SIG_DFL);
+    signalWakeFd = -1;
+
+    // a scene being built is finished first, and tasks being run
+    {
+        lock_guard<mutex> lock(jobMutex);
+        stopping = true;
+        if (!queued.empty() || !active.empty()) {
+            cout << "Stopping with " << queued.size() + active.size() << " jobs unfinished" << endl;
+        }
+    }
+    tasksQueued.notify_all();
+    scenesQueued.notify_all();
+    for (thread& t : threads) t.join();
+    loader.join();
+    cout << "Stopped after " << nextJob - 1 << " jobs" << endl;
+}
+
+}
+
+bool runRenderService(const string& address, const ServiceSettings& service) {
+    const vector<string>& names = sceneNames();
+    for (const string& name : service.preload) {
+        if (find(names.begin(), names.end(), name) == names.end()) {
+            cout << "Error :: Unknown scene '" << name << "'" << endl;
+            return false;
+        }
+    }
+    if (service.numThreads < 1 || service.maxActiveJobs < 1 || service.maxQueuedJobs < 1) {
+        cout << "Error :: The service needs at least one thread, active job and queued job" << endl;
+        return false;
+    }
+    unique_ptr<RenderServer> server(new RenderServer(service));
+    if (!server->listen(address)) return false;
+    server->run();
+    return true;
+}
+
+//---Client ----------------------------------------------------------------------------
+
+bool submitRenderJob(const string& address, const string& sceneName, const RenderSettings& settings,
+                     int priority, vector<glm::vec3>& image) {
+    string unixPath;
+    int fd = openSocket(address, false, unixPath);
+    if (fd < 0) {
+        cout << "Error :: Unable to connect to " << address << ": " << strerror(errno) << endl;
+        return false;
+    }
+
+    ostringstream jobText;
+    jobText << sceneName << "\n";
+    writeSettings(jobText, settings);
+    string job;
+    putU32(job, (uint32_t)priority);
+    job += jobText.str();
+
+    const size_t numCells = (size_t)settings.width * settings.height;
+    const uint64_t imageSize = 12 + (uint64_t)numCells * 12;
+    uint32_t type = 0;
+    string payload;
+    bool ok = sendMessage(fd, MSG_SUBMIT, job) && recvMessage(fd, type, payload) && payload.size() >= 4;
+    const int id = ok ? getU32(payload, 0) : 0;
+    ok = ok && type == MSG_ACCEPTED && imageSize <= MAX_IMAGE_PAYLOAD &&
+         recvMessage(fd, type, payload, imageSize) && payload.size() >= 4 && (int)getU32(payload, 0) == id;
+    close(fd);
+
+    if (type == MSG_REJECTED && payload.size() >= 4) {
+        cout << "Error :: The render service rejected the job: " << payload.substr(4) << endl;
+        return false;
+    }
+    ok = ok && type == MSG_IMAGE && payload.size() == imageSize &&
+         (int)getU32(payload, 4) == settings.width && (int)getU32(payload, 8) == settings.height;
+    if (!ok) {
+        cout << "Error :: Lost the connection to the render service" << endl;
+        return false;
+    }
+
+    image.resize(numCells);
+    size_t offset = 12;
+    for (glm::vec3& col : image) {
+        col.r = getFloat(payload, offset);
+        col.g = getFloat(payload, offset + 4);
+        col.b = getFloat(payload, offset + 8);
+        offset += 12;
+    }
+    return true;
+}
@@ -0,0 +1,652 @@
+/*==================================================================================
+* The renderer
+*   Traces primary rays from the camera through every cell of the image on
+*   worker threads and collects the colours into a framebuffer.
+*===================================================================================
+*/
+
+#include "Renderer.h"
+#include <cmath>
+#include <thread>
+#include <chrono>
+#include <string>
+#include <iostream>
+#include <algorithm>
+#include "Profiler.h"
+#include "Checkpoint.h"
+using namespace std;
+
+Renderer::Renderer(Scene *scene, const RenderSettings& settings) : scene(scene), settings(settings) {
+	framebuffer.resize((size_t)settings.width * settings.height);
+}
+
+int tileCount(int width, int height) {
+	return ((width + TILE_SIZE - 1) / TILE_SIZE) * ((height + TILE_SIZE - 1) / TILE_SIZE);
+}
+
+TileRect tileRect(int tile, int width, int height) {
+	const int tilesX = (width + TILE_SIZE - 1) / TILE_SIZE;
+	TileRect rect;
+	rect.x0 = (tile % tilesX) * TILE_SIZE;
+	rect.y0 = (tile / tilesX) * TILE_SIZE;
+	rect.x1 = std::min(rect.x0 + TILE_SIZE, width);
+	rect.y1 = std::min(rect.y0 + TILE_SIZE, height);
+	return rect;
+}
+
+//---Closest hit --------------------------------------------------------------------
+//   Finds the ray's closest point of intersection, walking the BVH when it is
+//   enabled instead of testing every object, and counts the tests it took.
+//----------------------------------------------------------------------------------
+void Renderer::closestPt(Ray& ray, RayStats& rayStats) {
+	if(settings.enableBVH) {
+		int nodeVisits = 0;
+		int primitiveTests = ray.closestPt(*scene->bvh, &nodeVisits);
+		RAY_STAT(rayStats.nodeVisits += nodeVisits);
+		RAY_STAT(rayStats.primitiveTests += primitiveTests);
+	} else {
+		int primitiveTests = ray.closestPt(scene->objects);
+		RAY_STAT(rayStats.primitiveTests += primitiveTests);
+	}
+}
+
+//---Shadow test -------------------------------------------------------------------
+//   Returns the fraction of the light's sample that reaches the hit point.
+//   Transparent and refractive objects only partially block the light. The
+//   path tracer passes the fraction they transmit; Whitted tracing keeps its
+//   softer look, never darker than 0.2 or lighter than 0.9.
+//----------------------------------------------------------------------------------
+float Renderer::shadowTransmittance(const glm::vec3& hit, const LightSample& light, int objIndex, RayStats& rayStats) {
+	Ray shadowRay(hit, light.dir);
+	shadowRay.tMax = std::min(shadowRay.tMax, light.dist);	//Nothing beyond the light can block it
+	closestPt(shadowRay, rayStats);
+	RAY_STAT(rayStats.shadowRays++);
+
+	if(!shadowRay.hit.isHit()) return 1.0f;
+	RAY_STAT(rayStats.occludedShadowRays++);
+
+	const int shadowIndex = shadowRay.hit.primID;
+	const Material& shadowMat = scene->materials[scene->objects[shadowIndex]->getMaterial()];
+	float shadowAlpha;
+	if(shadowMat.isTransparent() && !(shadowIndex == objIndex)) {
+		shadowAlpha = (1 - shadowMat.getTransparencyCoeff());
+	} else if(shadowMat.isRefractive() && !(shadowIndex == objIndex)){
+		shadowAlpha = (1 - shadowMat.getRefractionCoeff());
+	} else if(shadowMat.isDielectric() && !(shadowIndex == objIndex)) {
+		// what head-on light keeps through both surfaces; caustics are out of reach of a shadow ray
+		float r0 = (shadowMat.getRefractiveIndex() - 1) / (shadowMat.getRefractiveIndex() + 1);
+		shadowAlpha = (1 - r0 * r0) * (1 - r0 * r0);
+	} else {
+		return 0.0f;
+	}
+	return settings.pathTrace ? shadowAlpha : 0.2f + 0.7f * shadowAlpha;
+}
+
+//---Soft shadows ------------------------------------------------------------------
+//   Returns the fraction of an area light visible from the hit point.
+//   The light is split into a grid of strata and one jittered probe ray is fired
+//   into each quadrant of the grid. If the probes agree the point is fully lit or
+//   fully occluded and the probes are used as is. Only points in the penumbra
+//   fire a ray into every remaining cell.
+//----------------------------------------------------------------------------------
+float Renderer::areaLightVisibility(const glm::vec3& hit, Light* light, int objIndex, Random& rng, RayStats& rayStats) {
+	const int half = SHADOW_STRATA / 2;
+	bool probed[SHADOW_STRATA][SHADOW_STRATA] = {};
+	float probes[4];
+	RAY_STAT(rayStats.areaLightTests++);
+	RAY_STAT(rayStats.probeShadowRays += 4);
+
+	for(int q = 0; q < 4; q++) {
+		int cx = (q % 2) * half + rng.next() % half;
+		int cy = (q / 2) * half + rng.next() % half;
+		probed[cx][cy] = true;
+		float u1 = (cx + rng.nextFloat()) / SHADOW_STRATA;
+		float u2 = (cy + rng.nextFloat()) / SHADOW_STRATA;
+		probes[q] = shadowTransmittance(hit, light->sample(hit, u1, u2), objIndex, rayStats);
+	}
+
+	float sum = probes[0] + probes[1] + probes[2] + probes[3];
+	if(probes[0] == probes[1] && probes[0] == probes[2] && probes[0] == probes[3]) {
+		return probes[0];
+	}
+
+	RAY_STAT(rayStats.penumbraShadowRays += SHADOW_STRATA * SHADOW_STRATA - 4);
+	for(int cx = 0; cx < SHADOW_STRATA; cx++) {
+		for(int cy = 0; cy < SHADOW_STRATA; cy++) {
+			if(probed[cx][cy]) continue;
+			float u1 = (cx + rng.nextFloat()) / SHADOW_STRATA;
+			float u2 = (cy + rng.nextFloat()) / SHADOW_STRATA;
+			sum += shadowTransmittance(hit, light->sample(hit, u1, u2), objIndex, rayStats);
+		}
+	}
+	return sum / (SHADOW_STRATA * SHADOW_STRATA);
+}
+
+//---Direct lighting ---------------------------------------------------------------
+//   Fills samples with the shadowed light arriving at the hit point.
+//   With few lights every light is sampled. Otherwise MAX_LIGHT_SAMPLES lights
+//   are picked in proportion to their power and weighted by 1/pdf, so the number
+//   of shadow rays stays the same no matter how many lights are in the scene.
+//   The path tracer takes one random point on each area light instead of
+//   shading from the centre, since its samples average over the light anyway.
+//----------------------------------------------------------------------------------
+int Renderer::sampleLights(const glm::vec3& hit, int objIndex, LightSample* samples, Random& rng, RayStats& rayStats) {
+	const LightList& lights = scene->lights;
+	RAY_STAT(rayStats.shadingPoints++);
+	bool sampleAll = lights.size() <= MAX_LIGHT_SAMPLES;
+	int numSamples = sampleAll ? lights.size() : MAX_LIGHT_SAMPLES;
+
+	for(int i = 0; i < numSamples; i++) {
+		int lightIdx = i;
+		float weight = 1.0f;
+		if(!sampleAll) {
+			float pmf;
+			lightIdx = lights.sample(rng.nextFloat(), pmf);
+			weight = 1.0f / (numSamples * pmf);
+		}
+
+		// area lights are shaded from their centre and dimmed by the visible fraction
+		Light* source = lights[lightIdx];
+		bool pointSample = source->isDelta() || settings.pathTrace;
+		float u1 = 0.5f, u2 = 0.5f;
+		if(!source->isDelta() && settings.pathTrace) {
+			u1 = rng.nextFloat();
+			u2 = rng.nextFloat();
+		}
+		LightSample light = source->sample(hit, u1, u2);
+		light.radiance *= weight;
+		if(light.radiance != glm::vec3(0)) {
+			if(pointSample)
+				light.radiance *= shadowTransmittance(hit, light, objIndex, rayStats);
+			else
+				light.radiance *= areaLightVisibility(hit, source, objIndex, rng, rayStats);
+		}
+		samples[i] = light;
+	}
+	return numSamples;
+}
+
+//---Fresnel reflectance --------------------------------------------------------------
+//   Fraction of light reflected by a smooth dielectric boundary, unpolarised,
+//   from the exact Fresnel equations. cosI is the cosine between the incoming
+//   direction and the normal on its side, eta the ratio of the refractive
+//   index being left to the one being entered. Returns 1 for total internal
+//   reflection.
+//----------------------------------------------------------------------------------
+static float fresnelDielectric(float cosI, float eta) {
+	float sin2T = eta * eta * (1.0f - cosI * cosI);
+	if(sin2T >= 1.0f) return 1.0f;
+	float cosT = std::sqrt(1.0f - sin2T);
+	float rs = (eta * cosI - cosT) / (eta * cosI + cosT);
+	float rp = (cosI - eta * cosT) / (cosI + eta * cosT);
+	return 0.5f * (rs * rs + rp * rp);
+}
+
+//---Dielectrics ---------------------------------------------------------------------
+//   Glass reflects the Fresnel fraction of the light and refracts the rest,
+//   tinted by its colour. Up to settings.splitDepth both rays are traced and
+//   weighted; deeper, one is picked with the probability it would be weighted
+//   by, so paths through stacks of glass stop doubling at every surface.
+//   Solid objects are surrounded by air, so a ray leaving one goes back into it.
+//----------------------------------------------------------------------------------
+glm::vec3 Renderer::traceDielectric(Ray& ray, SceneObject* obj, const glm::vec3& normalVec, const RayDifferential& footprint,
+									float eta_1, int step, Random& rng, RayStats& rayStats) {
+	const glm::vec3 hitPt = ray.hitPoint();
+	const Material& mat = scene->materials[obj->getMaterial()];
+	glm::vec3 n = normalVec;
+	glm::vec3 dndx = obj->normal(hitPt + footprint.dPdx) - n;
+	glm::vec3 dndy = obj->normal(hitPt + footprint.dPdy) - n;
+	bool entering = glm::dot(ray.dir, n) < 0;
+	if(!entering) {
+		n = -n;
+		dndx = -dndx;
+		dndy = -dndy;
+	}
+	float eta_2 = entering ? mat.getRefractiveIndex() : 1.0f;
+	float fresnel = fresnelDielectric(-glm::dot(ray.dir, n), eta_1 / eta_2);
+
+	bool split = step <= settings.splitDepth;
+	bool reflect = split ? fresnel > 0.0f : rng.nextFloat() < fresnel;
+	bool refract = split ? fresnel < 1.0f : !reflect;
+	glm::vec3 color(0);
+	if(reflect) {
+		Ray reflectedRay(hitPt, glm::reflect(ray.dir, n));
+		RAY_STAT(rayStats.secondaryRays++);
+		color += (split ? fresnel : 1.0f) * trace(reflectedRay, footprint.reflect(ray.dir, n, dndx, dndy), eta_1, step + 1, rng, rayStats);
+	}
+	if(refract) {
+		Ray refractedRay(hitPt, glm::refract(ray.dir, n, eta_1 / eta_2));
+		RayDifferential refractedDiff = footprint.refract(ray.dir, n, dndx, dndy, eta_1 / eta_2);
+		RAY_STAT(rayStats.secondaryRays++);
+		glm::vec3 tint = mat.colorAt(obj, hitPt, glm::vec2(ray.hit.u, ray.hit.v), footprint);
+		color += (split ? 1.0f - fresnel : 1.0f) * tint * trace(refractedRay, refractedDiff, eta_2, step + 1, rng, rayStats);
+	}
+	return color;
+}
+
+// The albedo, normal and depth the denoiser is guided by, at the hit of ray
+static AuxSample auxSample(const Ray& ray, SceneObject* obj, const Material& mat, const glm::vec3& normalVec,
+						   const RayDifferential& footprint) {
+	AuxSample sample;
+	sample.albedo = mat.colorAt(obj, ray.hitPoint(), glm::vec2(ray.hit.u, ray.hit.v), footprint);
+	sample.normal = glm::dot(ray.dir, normalVec) > 0.0f ? -normalVec : normalVec;
+	sample.depth = ray.hit.t;
+	return sample;
+}
+
+//---The most important function in a ray tracer! ---------------------------------- 
+//   Computes the colour value obtained by tracing a ray and finding its 
+//     closest point of intersection with objects in the scene.
+//   eta_1 is the refractive index of the medium the ray travels through.
+//----------------------------------------------------------------------------------
+glm::vec3 Renderer::trace(Ray& ray, const RayDifferential& diff, float eta_1, int step, Random& rng, RayStats& rayStats,
+						  AuxSample* aux) {
+	glm::vec3 backgroundCol(0);						//Background colour = (0,0,0)
+	glm::vec3 color(0);
+	glm::vec3 reflectedColor(0);
+	glm::vec3 transmissiveColor(0);
+
+	SceneObject* obj;
+
+	RAY_STAT(rayStats.bounceDepth[std::min(step, BOUNCE_DEPTH_BINS) - 1]++);
+	closestPt(ray, rayStats);
+    if(!ray.hit.isHit()) return backgroundCol;		//no intersection
+	obj = scene->objects[ray.hit.primID];				//object on which the closest point of intersection is found
+	const Material& mat = scene->materials[obj->getMaterial()];
+	const glm::vec3 hitPt = ray.hitPoint();
+	//The differentials are carried to the hit point to give the pixel's footprint on the surface
+	glm::vec3 normalVec = obj->normal(hitPt);
+	RayDifferential footprint = diff.transfer(ray.dir, ray.hit.t, normalVec);
+	if(aux) *aux = auxSample(ray, obj, mat, normalVec, footprint);
+
+	// Glass has no colour of its own, only what it reflects and refracts and its highlights
+	if(mat.isDielectric()) {
+		if(step < settings.maxSteps) color = traceDielectric(ray, obj, normalVec, footprint, eta_1, step, rng, rayStats);
+		if(!mat.isSpecular()) return color;
+	}
+
+	// Shadow calculation
+	// Each light sample is attenuated by whatever lies between the hit and the light
+	// before it is used for lighting, so lights in shadow add no diffuse or specular
+	LightSample lightSamples[MAX_LIGHT_SAMPLES];
+	int numLightSamples = sampleLights(hitPt, ray.hit.primID, lightSamples, rng, rayStats);
+
+	//Object's colour
+	glm::vec3 surfaceColor = mat.colorAt(obj, hitPt, glm::vec2(ray.hit.u, ray.hit.v), footprint);
+	LightingResult result = mat.lighting(lightSamples, numLightSamples, -ray.dir, normalVec, surfaceColor);
+	if(mat.isDielectric()) return color + result.specular;
+	color = result.ambient + result.diffuse;
+
+	if (mat.isReflective() && step < settings.maxSteps) {
+		// Reflection calculation
+		float rho = mat.getReflectionCoeff();
+		if(glm::dot(ray.dir, normalVec) < 0.0f){
+			glm::vec3 reflectedDir = glm::reflect(ray.dir, normalVec);
+			Ray reflectedRay(hitPt, reflectedDir);
+			glm::vec3 dndx = obj->normal(hitPt + footprint.dPdx) - normalVec;
+			glm::vec3 dndy = obj->normal(hitPt + footprint.dPdy) - normalVec;
+			RAY_STAT(rayStats.secondaryRays++);
+			reflectedColor = trace(reflectedRay, footprint.reflect(ray.dir, normalVec, dndx, dndy), eta_1, step + 1, rng, rayStats);
+			color = (1-rho) * color + rho * reflectedColor;
+		}
+	}
+
+	if(mat.isTransparent() && step < settings.maxSteps) {
+		// Transparency calculation
+		float alpha = mat.getTransparencyCoeff();
+		Ray transparencyRay(hitPt, ray.dir);
+		RAY_STAT(rayStats.secondaryRays++);
+		transmissiveColor = trace(transparencyRay, footprint, eta_1, step + 1, rng, rayStats);
+		color = (alpha * color) + ((1 - alpha) * transmissiveColor);
+	} else if(mat.isRefractive() && step < settings.maxSteps) {
+		// Refraction calculation
+		// leaving the object goes back into air; past the critical angle the ray is reflected instead
+		float alpha = mat.getRefractionCoeff();
+		float eta_2 = mat.getRefractiveIndex();
+		glm::vec3 n = normalVec;
+		glm::vec3 dndx = obj->normal(hitPt + footprint.dPdx) - n;
+		glm::vec3 dndy = obj->normal(hitPt + footprint.dPdy) - n;
+		if(glm::dot(ray.dir, n) > 0) {
+			n = -n;
+			dndx = -dndx;
+			dndy = -dndy;
+			eta_2 = 1.0f;
+		}
+		glm::vec3 g = glm::refract(ray.dir, n, eta_1 / eta_2);
+		Ray refractedRay;
+		RayDifferential refractedDiff;
+		if(g == glm::vec3(0)) {
+			eta_2 = eta_1;
+			refractedRay = Ray(hitPt, glm::reflect(ray.dir, n));
+			refractedDiff = footprint.reflect(ray.dir, n, dndx, dndy);
+		} else {
+			refractedRay = Ray(hitPt, g);
+			refractedDiff = footprint.refract(ray.dir, n, dndx, dndy, eta_1 / eta_2);
+		}
+		RAY_STAT(rayStats.secondaryRays++);
+		transmissiveColor = trace(refractedRay, refractedDiff, eta_2, step + 1, rng, rayStats);
+		color = (alpha * color) + ((1 - alpha) * transmissiveColor);
+	}
+
+	// specular from lights in shadow has already been removed by sampleLights
+	// adding it after all other calculatinos ensures it's brightness 
+	// is preseved through transparency and reflection calculations
+	return color + result.specular;
+}
+
+//---Cosine-weighted direction about n ----------------------------------------------
+//   Picks a point on the unit disc and projects it up onto the hemisphere, so
+//   directions are chosen with pdf cos(theta) / pi. The basis around n is
+//   Duff et al.'s branchless one.
+//----------------------------------------------------------------------------------
+static glm::vec3 cosineDirection(const glm::vec3& n, float u1, float u2) {
+	float sign = std::copysign(1.0f, n.z);
+	float a = -1.0f / (sign + n.z);
+	float b = n.x * n.y * a;
+	glm::vec3 t(1.0f + sign * n.x * n.x * a, sign * b, -sign * n.x);
+	glm::vec3 bt(b, sign + n.y * n.y * a, -n.y);
+
+	float r = std::sqrt(u1);
+	float phi = 2.0f * (float)M_PI * u2;
+	return r * std::cos(phi) * t + r * std::sin(phi) * bt + std::sqrt(std::max(0.0f, 1.0f - u1)) * n;
+}
+
+//---Path tracing -------------------------------------------------------------------
+//   Follows one path from the camera, choosing one event at each hit with the
+//   probability trace() would weight it by: passing through a transparent or
+//   refractive object, a mirror reflection, or a diffuse bounce, and at glass
+//   reflection or refraction by its Fresnel reflectance. The choice
+//   replaces the weight, so the path's throughput only changes by the surface
+//   colour at diffuse bounces. Lights are sampled directly at every diffuse
+//   bounce (next event estimation), and the bounce itself leaves in a
+//   cosine-weighted direction, whose pdf cancels the cosine of the diffuse
+//   term. After ROULETTE_DEPTH bounces Russian roulette ends dim paths early,
+//   dividing the survivors by their chance of surviving so the mean is
+//   unchanged. Lights cannot be hit by a path, so nothing is counted twice.
+//----------------------------------------------------------------------------------
+glm::vec3 Renderer::tracePath(Ray& ray, const RayDifferential& diff, Random& rng, RayStats& rayStats, AuxSample* aux) {
+	glm::vec3 radiance(0);
+	glm::vec3 throughput(1);
+	RayDifferential rayDiff = diff;
+	float pathLength = 0.0f;
+
+	for(int step = 1; step <= settings.maxSteps; step++) {
+		RAY_STAT(rayStats.bounceDepth[std::min(step, BOUNCE_DEPTH_BINS) - 1]++);
+		closestPt(ray, rayStats);
+		if(!ray.hit.isHit()) break;
+		SceneObject* obj = scene->objects[ray.hit.primID];
+		const Material& mat = scene->materials[obj->getMaterial()];
+		const glm::vec3 hitPt = ray.hitPoint();
+		const glm::vec3 normalVec = obj->normal(hitPt);
+		RayDifferential footprint = rayDiff.transfer(ray.dir, ray.hit.t, normalVec);
+		const glm::vec2 uv(ray.hit.u, ray.hit.v);
+		pathLength += ray.hit.t;
+
+		float pTransmit = 0.0f;
+		if(mat.isTransparent()) pTransmit = 1.0f - mat.getTransparencyCoeff();
+		else if(mat.isRefractive()) pTransmit = 1.0f - mat.getRefractionCoeff();
+		float pMirror = mat.isReflective() ? (1.0f - pTransmit) * mat.getReflectionCoeff() : 0.0f;
+		float u = rng.nextFloat();
+		bool diffuse = !mat.isDielectric() && u >= pTransmit + pMirror;
+
+		// The aux sample is taken from the first surface seen through any glass and mirrors, so
+		// the denoiser keeps what they show sharp. Surfaces that are partly mirror would pick one
+		// or the other at random, so they are taken as they are.
+		if(aux && (step == settings.maxSteps || (!mat.isDielectric() && pTransmit + pMirror < 1.0f))) {
+			*aux = auxSample(ray, obj, mat, normalVec, footprint);
+			aux->albedo *= throughput;
+			aux->depth = pathLength;
+			aux = nullptr;
+		}
+
+		// specular highlights are added at every hit, as trace() does
+		glm::vec3 surfaceColor(1);
+		if(diffuse || mat.isSpecular()) {
+			LightSample lightSamples[MAX_LIGHT_SAMPLES];
+			int numLightSamples = sampleLights(hitPt, ray.hit.primID, lightSamples, rng, rayStats);
+			surfaceColor = mat.colorAt(obj, hitPt, uv, footprint);
+			LightingResult result = mat.lighting(lightSamples, numLightSamples, -ray.dir, normalVec, surfaceColor);
+			radiance += throughput * result.specular;
+			if(diffuse) radiance += throughput * result.diffuse;
+		}
+		if(step == settings.maxSteps) break;
+
+		glm::vec3 n = glm::dot(ray.dir, normalVec) > 0.0f ? -normalVec : normalVec;	//Facing the path
+		// the differentials follow specular events as in trace(), and diffuse bounces widen them
+		glm::vec3 dndx(0), dndy(0);
+		if(!diffuse) {
+			float facing = n == normalVec ? 1.0f : -1.0f;
+			dndx = facing * (obj->normal(hitPt + footprint.dPdx) - normalVec);
+			dndy = facing * (obj->normal(hitPt + footprint.dPdy) - normalVec);
+		}
+		Ray next;
+		RayDifferential nextDiff;
+		if(mat.isDielectric()) {
+			float eta = n == normalVec ? 1.0f / mat.getRefractiveIndex() : mat.getRefractiveIndex();
+			if(u < fresnelDielectric(-glm::dot(ray.dir, n), eta)) {
+				next = Ray(hitPt, glm::reflect(ray.dir, n));
+				nextDiff = footprint.reflect(ray.dir, n, dndx, dndy);
+			} else {
+				throughput *= mat.colorAt(obj, hitPt, uv, footprint);
+				next = Ray(hitPt, glm::refract(ray.dir, n, eta));
+				nextDiff = footprint.refract(ray.dir, n, dndx, dndy, eta);
+			}
+		} else if(u < pTransmit && mat.isTransparent()) {
+			next = Ray(hitPt, ray.dir);
+			nextDiff = footprint;
+		} else if(u < pTransmit) {
+			// objects are surrounded by air, so a path leaving one goes back into it
+			float eta = n == normalVec ? 1.0f / mat.getRefractiveIndex() : mat.getRefractiveIndex();
+			glm::vec3 g = glm::refract(ray.dir, n, eta);
+			if(g == glm::vec3(0)) {
+				next = Ray(hitPt, glm::reflect(ray.dir, n));	//Total internal reflection
+				nextDiff = footprint.reflect(ray.dir, n, dndx, dndy);
+			} else {
+				next = Ray(hitPt, g);
+				nextDiff = footprint.refract(ray.dir, n, dndx, dndy, eta);
+			}
+		} else if(!diffuse) {
+			next = Ray(hitPt, glm::reflect(ray.dir, n));
+			nextDiff = footprint.reflect(ray.dir, n, dndx, dndy);
+		} else {
+			throughput *= surfaceColor;
+			float u1 = rng.nextFloat();
+			float u2 = rng.nextFloat();
+			next = Ray(hitPt, cosineDirection(n, u1, u2));
+			nextDiff = footprint.scatter(next.dir, DIFFUSE_SPREAD);
+		}
+		RAY_STAT(rayStats.secondaryRays++);
+
+		if(step >= ROULETTE_DEPTH) {
+			float survive = std::min(0.95f, std::max(throughput.r, std::max(throughput.g, throughput.b)));
+			if(rng.nextFloat() >= survive) break;
+			throughput /= survive;
+		}
+		ray = next;
+		rayDiff = nextDiff;
+	}
+	return radiance;
+}
+
+// Colour of one camera ray with the integrator chosen by the settings
+glm::vec3 Renderer::traceSample(Ray& ray, const RayDifferential& diff, Random& rng, RayStats& rayStats, AuxSample* aux) {
+	return settings.pathTrace ? tracePath(ray, diff, rng, rayStats, aux) : trace(ray, diff, 1.0f, 1, rng, rayStats, aux);
+}
+
+void Renderer::printRayDebug() {
+	stats.print();
+}
+
+//---Traces one cell -----------------------------------------------------------------
+// Fires a grid of aaSamples x aaSamples primary rays through cell (i, j) when
+// anti-aliasing, or one through its centre, and averages their colours.
+//---------------------------------------------------------------------------------------
+glm::vec3 Renderer::renderPixel(int i, int j, RayStats& rayStats) {
+	const int aaSamples = settings.enableAA ? settings.aaSamples : 1;
+	const size_t cell = (size_t)j * settings.width + i;
+	Random rng(cell);	//Seeded per pixel so every frame is reproducible
+	glm::vec3 col(0.0f);
+	if(settings.denoise) aux.clear(cell);
+	for(int sx = 0; sx < aaSamples; sx++) {
+		for(int sy = 0; sy < aaSamples; sy++) {
+			float x = i + (sx + 0.5f) / aaSamples;
+			float y = j + (sy + 0.5f) / aaSamples;
+			float lensU = 0.5f, lensV = 0.5f;
+			if(camera.hasDepthOfField()) {
+				lensU = rng.nextFloat();
+				lensV = rng.nextFloat();
+			}
+			RayDifferential diff;
+			Ray ray = camera.generateRay(x, y, lensU, lensV, diff);
+			RAY_STAT(rayStats.primaryRays++);
+			AuxSample sample;
+			col += traceSample(ray, diff, rng, rayStats, settings.denoise ? &sample : nullptr);
+			if(settings.denoise) aux.add(cell, sample);
+		}
+	}
+	return col / (float)(aaSamples * aaSamples);
+}
+
+//---Adds one sample to a cell of the accumulation ------------------------------------
+// The sample is jittered within the cell, and the cell's generator carries on
+// from where its last sample left it.
+//---------------------------------------------------------------------------------------
+glm::vec3 Renderer::accumulatePixel(int i, int j, RayStats& rayStats) {
+	const size_t cell = (size_t)j * settings.width + i;
+	Random rng(0);
+	rng.setState(accumulation->rngState[cell]);
+	float x = i + rng.nextFloat();
+	float y = j + rng.nextFloat();
+	float lensU = 0.5f, lensV = 0.5f;
+	if(camera.hasDepthOfField()) {
+		lensU = rng.nextFloat();
+		lensV = rng.nextFloat();
+	}
+	RayDifferential diff;
+	Ray ray = camera.generateRay(x, y, lensU, lensV, diff);
+	RAY_STAT(rayStats.primaryRays++);
+	AuxSample sample;
+	accumulation->sum[cell] += traceSample(ray, diff, rng, rayStats, settings.denoise ? &sample : nullptr);
+	if(settings.denoise) aux.add(cell, sample);	//Averaged over every pass this renderer has traced
+	accumulation->samples[cell]++;
+	accumulation->rngState[cell] = rng.getState();
+	return accumulation->mean(cell);
+}
+
+//---Traces one tile -----------------------------------------------------------------
+void Renderer::renderTile(int tile, RayStats& rayStats) {
+	ProfileScope tileScope("trace tile", "worker", tile);
+	const TileRect rect = tileRect(tile, settings.width, settings.height);
+
+	for(int j = rect.y0; j < rect.y1; j++) {
+		for(int i = rect.x0; i < rect.x1; i++) {
+			size_t pixel = (size_t)j * settings.width + i;
+
+			// the pixel's cost is the difference in the thread's counters across it
+			RayStats before;
+			std::chrono::steady_clock::time_point start;
+			if(settings.recordHeatmaps) {
+				before = rayStats;
+				start = std::chrono::steady_clock::now();
+			}
+
+			framebuffer[pixel] = accumulation ? accumulatePixel(i, j, rayStats) : renderPixel(i, j, rayStats);
+
+			if(settings.recordHeatmaps) {
+				heatmaps.nanoseconds[pixel] = std::chrono::duration<float, std::nano>(std::chrono::steady_clock::now() - start).count();
+				heatmaps.nodeVisits[pixel] = rayStats.nodeVisits - before.nodeVisits;
+				heatmaps.primitiveTests[pixel] = rayStats.primitiveTests - before.primitiveTests;
+				heatmaps.bounceDepth[pixel] = 0;
+				for(int d = BOUNCE_DEPTH_BINS - 1; d > 0; d--) {
+					if(rayStats.bounceDepth[d] != before.bounceDepth[d]) {
+						heatmaps.bounceDepth[pixel] = d;
+						break;
+					}
+				}
+			}
+		}
+	}
+}
+
+// Each worker takes the next untraced tile until there are none left
+void Renderer::renderWorker(int worker, const std::vector<int> *tiles, RayStats *rayStats) {
+	if(Profiler::isRunning()) Profiler::setThread(worker + 1, "worker " + std::to_string(worker));
+	const int numTiles = (int)tiles->size();
+	for(int k = nextTile++; k < numTiles; k = nextTile++) {
+		renderTile((*tiles)[k], *rayStats);
+	}
+}
+
+//---Renders one frame ---------------------------------------------------------------
+void Renderer::render() {
+	traceFrame();
+	if(settings.denoise) denoise();
+}
+
+// Only the last pass's means are wanted denoised, so the caller denoises them once, after it
+void Renderer::renderPass(Accumulation& accumulation) {
+	this->accumulation = &accumulation;
+	traceFrame();
+	this->accumulation = nullptr;
+	accumulation.passes++;
+}
+
+void Renderer::traceFrame() {
+	ProfileScope frameScope("render");
+
+	std::vector<int> tiles(getNumTiles());
+	for(size_t i = 0; i < tiles.size(); i++) tiles[i] = (int)i;
+	beginFrame();
+	renderTiles(tiles);
+}
+
+// The framebuffer holds the means of the accumulation during progressive rendering, so denoising it leaves the samples alone
+void Renderer::denoise() {
+	::denoise(framebuffer, aux, settings.numThreads, framebuffer);
+}
+
+// Sets up the frame's camera and clears the frame's ray statistics
+void Renderer::beginFrame() {
+	camera = scene->camera;
+	if(settings.overrideEye || settings.overrideLookAt) {
+		glm::vec3 eye = settings.overrideEye ? settings.eye : camera.getEye();
+		glm::vec3 target = settings.overrideLookAt ? settings.lookAt : eye + camera.getForward();
+		camera.lookAt(eye, target);
+	}
+	if(settings.fov > 0) camera.setFov(settings.fov);
+	if(settings.aperture >= 0) camera.setAperture(settings.aperture);
+	if(settings.focusDistance > 0) camera.setFocusDistance(settings.focusDistance);
+	camera.setResolution(settings.width, settings.height);
+
+	if(framebuffer.size() != (size_t)settings.width * settings.height)
+		framebuffer.resize((size_t)settings.width * settings.height);
+	if(settings.recordHeatmaps && (heatmaps.width != settings.width || heatmaps.height != settings.height))
+		heatmaps.resize(settings.width, settings.height);
+	if(settings.denoise && (aux.width != settings.width || aux.height != settings.height))
+		aux.resize(settings.width, settings.height);
+	stats = RayStats();
+}
+
+//---Traces the given tiles on the worker threads ------------------------------------
+// Each thread counts its rays separately, they are added to the frame's
+// statistics once the threads are done.
+//---------------------------------------------------------------------------------------
+void Renderer::renderTiles(const std::vector<int>& tiles) {
+	const int numThreads = std::min<int>(settings.numThreads, std::max<int>(1, tiles.size()));
+	nextTile = 0;
+
+	std::vector<std::thread> threads(numThreads);
+	std::vector<RayStats> threadStats(numThreads);
+	{
+		ProfileScope scope("spawn threads");
+		for (int i = 0; i < numThreads; i++) {
+			threads[i] = std::thread(&Renderer::renderWorker, this, i, &tiles, &threadStats[i]);
+		}
+	}
+
+	ProfileScope joinScope("join threads");
+	for (int i = 0; i < numThreads; i++) {
+		threads[i].join();
+		stats.add(threadStats[i]);
+	}
+}
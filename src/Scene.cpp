@@ -0,0 +1,417 @@
+#include "Scene.h"
+#include <cmath>
+#include <iostream>
+#include <unordered_map>
+#include "FilePath.h"
+#include "Plane.h"
+#include "Cylinder.h"
+#include "Cone.h"
+#include "Sphere.h"
+
+// The default view window, scenes are laid out to fill it
+const float XMIN = -10.0;
+const float XMAX = 10.0;
+const float YMIN = -10.0;
+const float YMAX = 10.0;
+
+Scene::~Scene() {
+	clear();
+}
+
+void Scene::build() {
+	lights.build();
+	delete bvh;
+	bvh = nullptr;
+	if(objects.empty()) return;
+	bvh = new BVH(&objects);
+	packObjects();
+}
+
+//Copies the objects into a new arena in the order the BVH sorted them into, so the objects a
+//leaf tests sit next to each other in memory, then frees the originals in one go
+void Scene::packObjects() {
+	Arena packed;
+	for(SceneObject*& obj : objects) obj = obj->clone(packed);
+	arena.swap(packed);
+	objectIndex.assign(objects.size(), -1);
+	for(size_t i = 0; i < objects.size(); i++) objectIndex[objects[i]->getId()] = i;
+}
+
+SceneObject* Scene::object(int id) {
+	return objectIndex.empty() ? objects[id] : objects[objectIndex[id]];
+}
+
+void Scene::clear() {
+	delete bvh;
+	bvh = nullptr;
+	objects.clear();
+	objectIndex.clear();
+	arena.reset();
+	materials.clear();
+	lights.clear();
+	camera = Camera();
+	cameraPath = CameraPath();
+	animate = nullptr;
+}
+
+// Refitting keeps the tree built for the first pose, which is fine while objects move a little relative to each other
+void Scene::update(float time) {
+	if(animate) animate(*this, time);
+	cameraPath.apply(camera, time);
+	if(bvh) bvh->refit();
+}
+
+//---The demo scene ------------------------------------------------------------------
+//   Spheres, a cylinder and a cone in a box of patterned and mirrored walls,
+//   lit by a point light or a square area light around the same centre
+//----------------------------------------------------------------------------------
+void buildDemoScene(Scene& scene, TextureCache& textureCache, const bool areaLight) {
+	// Textures are decoded in parallel up front and shared through the cache
+	textureCache.preload({ getFilePath("Earth.bmp") });
+
+	// Materials
+	Material blue, earth, red, green, cyan, magenta;
+	blue.setColor(glm::vec3(0, 0, 1));
+	blue.setReflectivity(true, 0.5);
+	earth.addTexture(textureCache.load(getFilePath("Earth.bmp")));
+	earth.setShininess(50);
+	red.setColor(glm::vec3(1, 0, 0));
+	red.setShininess(100);
+	red.setTransparency(true, 0.3);
+	green.setColor(glm::vec3(0, 1, 0));
+	green.setSpecularity(false);
+	green.setRefractivity(true, 0.1, 1.1);
+	cyan.setColor(glm::vec3(0, 1, 1));
+	cyan.setReflectivity(true, 0.7);
+	magenta.setColor(glm::vec3(1, 0, 1));
+
+	Material stripes, mirrorWall, checkers, redWall, blueWall;
+	stripes.setColor(glm::vec3(0.8, 0.8, 0));
+	stripes.setSpecularity(false);
+	stripes.addStripe(5, glm::vec3(0, 0, 1), {glm::vec3(0, 1, 0), glm::vec3(1, 1, 0.5)});
+	mirrorWall.setColor(glm::vec3(0.5, 0.5, 0.5));
+	mirrorWall.setSpecularity(false);
+	mirrorWall.setReflectivity(true, 1.);
+	checkers.setColor(glm::vec3(0.8, 0.8, 0.8));
+	checkers.setSpecularity(false);
+	checkers.addChecker(2, glm::vec3(0, 0, 0), glm::vec3(1, 1, 1));
+	redWall.setColor(glm::vec3(1, 0, 0));
+	redWall.setSpecularity(false);
+	blueWall.setColor(glm::vec3(0, 0.5, 1));
+	blueWall.setSpecularity(false);
+
+	// Objects
+	Sphere *sphere1 = scene.add<Sphere>(glm::vec3(-15.0, -5.0, -60.0), 5.0);
+	sphere1->setMaterial(scene.materials.add(blue));
+
+	Sphere *sphere2 = scene.add<Sphere>(glm::vec3(-5, 7, -60), 3.0);
+	sphere2->setMaterial(scene.materials.add(earth));
+
+	Sphere *sphere3 = scene.add<Sphere>(glm::vec3(15, -5.0, -60), 5.0);
+	sphere3->setMaterial(scene.materials.add(red));
+
+	Sphere *sphere4 = scene.add<Sphere>(glm::vec3(0, -5.0, -60), 5.0);
+	sphere4->setMaterial(scene.materials.add(green));
+
+	Cylinder *cylinder = scene.add<Cylinder>(glm::vec3(6.5, -15, -50), 2, 10);
+	cylinder->setMaterial(scene.materials.add(cyan));
+
+	Cone *cone = scene.add<Cone>(glm::vec3(-6.5, -5, -50), 5, 10);
+	cone->setMaterial(scene.materials.add(magenta));
+
+	// Lights
+	if(areaLight) scene.lights.add(new QuadLight(glm::vec3(4, 30, -9), glm::vec3(12, 0, 0), glm::vec3(0, 0, 12)));
+	else scene.lights.add(new PointLight(glm::vec3(10, 30, -3)));
+
+	// Walls
+	Plane *floor = scene.add<Plane>(glm::vec3(-40., -15, 20), //Point A
+							  glm::vec3(40., -15, 20), //Point B
+							  glm::vec3(40., -15, -200), //Point C
+							  glm::vec3(-40., -15, -200)); //Point D
+	floor->setMaterial(scene.materials.add(stripes));
+
+	Plane *backWall = scene.add<Plane>(glm::vec3(-40., -15, -200), //Point A
+								glm::vec3(40., -15, -200), //Point B
+								glm::vec3(40., 40, -200), //Point C
+								glm::vec3(-40., 40, -200)); //Point D
+	const MaterialId mirror = scene.materials.add(mirrorWall);	//The back and front walls face each other
+	backWall->setMaterial(mirror);
+
+	Plane *ceiling = scene.add<Plane>(glm::vec3(-50, 40, 20), //Point A
+							   glm::vec3(-50, 40, -200), //Point B
+							   glm::vec3(50, 40, -200), //Point C
+							   glm::vec3(50, 40, 20)); //Point D
+	ceiling->setMaterial(scene.materials.add(checkers));
+
+	Plane *leftWall = scene.add<Plane>(glm::vec3(-40., -15, 20), //Point A
+								glm::vec3(-40., -15, -200), //Point B
+								glm::vec3(-40., 40, -200), //Point C
+								glm::vec3(-40., 40, 20)); //Point D
+	leftWall->setMaterial(scene.materials.add(redWall));
+
+	Plane *rightWall = scene.add<Plane>(glm::vec3(40., -15, 20), //Point A
+								glm::vec3(40., 40, 20), //Point B
+								glm::vec3(40., 40, -200), //Point C
+								glm::vec3(40., -15, -200)); //Point D
+	rightWall->setMaterial(scene.materials.add(blueWall));
+
+	Plane *frontWall = scene.add<Plane>(glm::vec3(-40., -15, 20), //Point A
+								glm::vec3(-40., 40, 20), //Point B
+								glm::vec3(40., 40, 20), //Point C
+								glm::vec3(40., -15, 20)); //Point D
+	frontWall->setMaterial(mirror);
+
+	// Animation, an eight second loop: the camera circles in front of the
+	// objects while the blue sphere bounces and the red one sways
+	scene.cameraPath.addKey(0, glm::vec3(0, 0, 0), glm::vec3(0, 0, -60));
+	scene.cameraPath.addKey(2, glm::vec3(12, 4, -15), glm::vec3(0, -5, -60));
+	scene.cameraPath.addKey(4, glm::vec3(0, 8, -25), glm::vec3(0, -5, -60));
+	scene.cameraPath.addKey(6, glm::vec3(-12, 4, -15), glm::vec3(0, -5, -60));
+	scene.cameraPath.addKey(8, glm::vec3(0, 0, 0), glm::vec3(0, 0, -60));
+	glm::vec3 bounce(0), sway(0);	//Where the spheres have been moved to from their starting points
+	const int bouncing = sphere1->getId(), swaying = sphere3->getId();	//build() moves the objects
+	scene.animate = [=](Scene& posed, float time) mutable {
+		glm::vec3 newBounce(0, 8 * fabs(sin(time * M_PI / 2)), 0);
+		glm::vec3 newSway(3 * sin(time * M_PI / 4), 0, 0);
+		posed.object(bouncing)->translate(newBounce - bounce);
+		posed.object(swaying)->translate(newSway - sway);
+		bounce = newBounce;
+		sway = newSway;
+	};
+}
+
+//Random colours from a palette of 20 levels per channel, so a million spheres share 8000 materials
+static MaterialId randomColor(Scene& scene, std::unordered_map<int, MaterialId>& palette) {
+	int r = (rand() % 100) / 5, g = (rand() % 100) / 5, b = (rand() % 100) / 5;
+	auto found = palette.find((r * 20 + g) * 20 + b);
+	if(found != palette.end()) return found->second;
+	Material material;
+	material.setColor(glm::vec3(r, g, b) / 20.0f);
+	return palette[(r * 20 + g) * 20 + b] = scene.materials.add(material);
+}
+
+void drawCircles(Scene& scene, const int numSpheres, const bool useRandomPlacement) {
+	std::unordered_map<int, MaterialId> palette;
+	for(int i = 0; i < numSpheres; i++) {
+		if(useRandomPlacement) {
+			float x = (rand() % 20) - 10;
+			float y = (rand() % 20) - 10;
+			float z = (rand() % 20) - 10;
+			float r = static_cast<float>(rand()) / static_cast<float>(RAND_MAX) * 5.0f;
+			Sphere *sphere = scene.add<Sphere>(glm::vec3(x, y, -70 + z), r);
+			sphere->setMaterial(randomColor(scene, palette));
+		}else{
+			const int rows = ceil(sqrt(numSpheres));
+			const int cols = floor(sqrt(numSpheres));
+			const float xSpacing = (XMAX - XMIN) / (cols + 1);
+			const float ySpacing = (YMAX - YMIN) / (rows + 1);
+
+			//space spheres out evenly and set size so all are visible
+			int rowIndex = i / cols;
+    		int colIndex = i % cols;
+
+			float x = XMIN + (colIndex + 1) * xSpacing;
+    		float y = YMIN + (rowIndex + 1) * ySpacing;
+			float z = -40;
+			float r = 0.5f;
+			Sphere *sphere = scene.add<Sphere>(glm::vec3(x, y, z), r);
+			sphere->setMaterial(randomColor(scene, palette));
+		}
+	}
+}
+
+//---Mirror corridor -----------------------------------------------------------------
+//   Two parallel mirrors with spheres between them, so most rays bounce
+//   until they run out of steps
+//----------------------------------------------------------------------------------
+void buildMirrorCorridor(Scene& scene) {
+	Plane *leftMirror = scene.add<Plane>(glm::vec3(-12., -15, 20), //Point A
+								  glm::vec3(-12., -15, -200), //Point B
+								  glm::vec3(-12., 40, -200), //Point C
+								  glm::vec3(-12., 40, 20)); //Point D
+	Material mirror;
+	mirror.setColor(glm::vec3(0.8, 0.8, 0.8));
+	mirror.setSpecularity(false);
+	mirror.setReflectivity(true, 0.9);
+	const MaterialId mirrorId = scene.materials.add(mirror);
+	leftMirror->setMaterial(mirrorId);
+
+	Plane *rightMirror = scene.add<Plane>(glm::vec3(12., -15, 20), //Point A
+								   glm::vec3(12., 40, 20), //Point B
+								   glm::vec3(12., 40, -200), //Point C
+								   glm::vec3(12., -15, -200)); //Point D
+	rightMirror->setMaterial(mirrorId);
+
+	Plane *floor = scene.add<Plane>(glm::vec3(-12., -10, 20), //Point A
+							 glm::vec3(12., -10, 20), //Point B
+							 glm::vec3(12., -10, -200), //Point C
+							 glm::vec3(-12., -10, -200)); //Point D
+	Material tiles;
+	tiles.setSpecularity(false);
+	tiles.addChecker(2, glm::vec3(0.2, 0.2, 0.2), glm::vec3(0.9, 0.9, 0.9));
+	floor->setMaterial(scene.materials.add(tiles));
+
+	for(int i = 0; i < 8; i++) {
+		Sphere *sphere = scene.add<Sphere>(glm::vec3((i % 2 == 0) ? -4 : 4, -7, -30 - 15 * i), 3.0);
+		Material material;
+		material.setColor(glm::vec3(0.2 + 0.1 * i, 0.3, 1.0 - 0.1 * i));
+		if(i % 3 == 0) material.setReflectivity(true, 0.6);
+		sphere->setMaterial(scene.materials.add(material));
+	}
+
+	scene.lights.add(new PointLight(glm::vec3(0, 30, -40)));
+}
+
+//---Glass spheres -------------------------------------------------------------------
+//   Three rows of glass spheres over a checkered floor, so most primary rays
+//   pass through several glass surfaces before reaching anything opaque
+//----------------------------------------------------------------------------------
+void buildGlassSpheres(Scene& scene) {
+	Plane *floor = scene.add<Plane>(glm::vec3(-40., -10, 20), //Point A
+							 glm::vec3(40., -10, 20), //Point B
+							 glm::vec3(40., -10, -200), //Point C
+							 glm::vec3(-40., -10, -200)); //Point D
+	Material tiles;
+	tiles.setSpecularity(false);
+	tiles.addChecker(4, glm::vec3(0.2, 0.2, 0.2), glm::vec3(0.9, 0.9, 0.9));
+	floor->setMaterial(scene.materials.add(tiles));
+
+	Plane *backWall = scene.add<Plane>(glm::vec3(-40., -10, -120), //Point A
+								glm::vec3(40., -10, -120), //Point B
+								glm::vec3(40., 40, -120), //Point C
+								glm::vec3(-40., 40, -120)); //Point D
+	Material wall;
+	wall.setColor(glm::vec3(0.3, 0.5, 0.8));
+	wall.setSpecularity(false);
+	backWall->setMaterial(scene.materials.add(wall));
+
+	const glm::vec3 tints[3] = { glm::vec3(1.0, 1.0, 1.0), glm::vec3(0.85, 1.0, 0.9), glm::vec3(1.0, 0.9, 0.8) };
+	for(int row = 0; row < 3; row++) {
+		Material glass;
+		glass.setColor(tints[row]);
+		glass.setDielectric(true, 1.5);
+		const MaterialId glassId = scene.materials.add(glass);	//Shared by the row
+		for(int col = 0; col < 5; col++) {
+			Sphere *sphere = scene.add<Sphere>(glm::vec3(-12 + 6 * col + 3 * (row % 2), -7, -45 - 10 * row), 2.8);
+			sphere->setMaterial(glassId);
+		}
+	}
+	Material solidRed;
+	solidRed.setColor(glm::vec3(0.9, 0.2, 0.1));
+	Sphere *solid = scene.add<Sphere>(glm::vec3(0, -4, -90), 6.0);
+	solid->setMaterial(scene.materials.add(solidRed));
+
+	scene.lights.add(new PointLight(glm::vec3(-10, 30, -20)));
+}
+
+//---Triangle mesh -------------------------------------------------------------------
+//   A tessellated sphere made of roughly numTriangles triangles
+//----------------------------------------------------------------------------------
+void buildMesh(Scene& scene, const int numTriangles) {
+	const glm::vec3 center(0, 0, -60);
+	const float radius = 10.0;
+	const int stacks = std::max(2, (int)sqrt(numTriangles / 4.0));
+	const int slices = 2 * stacks;
+
+	auto vertex = [&](int stack, int slice) {
+		float theta = M_PI * stack / stacks;
+		float phi = 2 * M_PI * slice / slices;
+		return center + radius * glm::vec3(sin(theta) * cos(phi), cos(theta), sin(theta) * sin(phi));
+	};
+	Material orange;
+	orange.setColor(glm::vec3(0.9, 0.6, 0.2));
+	const MaterialId orangeId = scene.materials.add(orange);	//Every triangle shares it
+
+	auto addTriangle = [&](glm::vec3 a, glm::vec3 b, glm::vec3 c) {
+		glm::vec3 n = glm::cross(c - b, a - b);
+		if(glm::length(n) < 1.e-8) return;   //Degenerate triangle at a pole
+		if(glm::dot(n, (a + b + c) / 3.0f - center) < 0) std::swap(b, c);   //Face outwards
+		Plane *triangle = scene.add<Plane>(a, b, c);
+		triangle->setMaterial(orangeId);
+	};
+
+	for(int i = 0; i < stacks; i++) {
+		for(int j = 0; j < slices; j++) {
+			glm::vec3 a = vertex(i, j), b = vertex(i + 1, j);
+			glm::vec3 c = vertex(i + 1, j + 1), d = vertex(i, j + 1);
+			addTriangle(a, b, c);
+			addTriangle(a, c, d);
+		}
+	}
+
+	scene.lights.add(new PointLight(glm::vec3(10, 30, -3)));
+}
+
+//---Many lights ---------------------------------------------------------------------
+//   A field of spheres under a canopy of numLights coloured point and spot
+//   lights and a dim sun. There are far more lights than MAX_LIGHT_SAMPLES, so
+//   every shading point picks its lights from the scene's alias table.
+//----------------------------------------------------------------------------------
+void buildManyLights(Scene& scene, const int numLights) {
+	Plane *floor = scene.add<Plane>(glm::vec3(-40., -10, 20), //Point A
+							 glm::vec3(40., -10, 20), //Point B
+							 glm::vec3(40., -10, -200), //Point C
+							 glm::vec3(-40., -10, -200)); //Point D
+	Material tiles;
+	tiles.setSpecularity(false);
+	tiles.addChecker(4, glm::vec3(0.3, 0.3, 0.3), glm::vec3(0.9, 0.9, 0.9));
+	floor->setMaterial(scene.materials.add(tiles));
+
+	Material white;
+	white.setColor(glm::vec3(0.9, 0.9, 0.9));
+	const MaterialId whiteId = scene.materials.add(white);
+	for(int row = 0; row < 4; row++) {
+		for(int col = 0; col < 7; col++) {
+			Sphere *sphere = scene.add<Sphere>(glm::vec3(-18 + 6 * col, -7, -45 - 10 * row), 2.5);
+			sphere->setMaterial(whiteId);
+		}
+	}
+
+	// Lights on a grid over the spheres, every fourth a spot pointing straight down.
+	// Point lights don't fall off with distance, so each gets a share of the total
+	const int side = (int)ceil(sqrt((float)numLights));
+	const float share = 1.5f / numLights;
+	for(int i = 0; i < numLights; i++) {
+		glm::vec3 position(-30 + 60.0f * (i % side) / side, 15 + 5 * (i % 3), -20 - 100.0f * (i / side) / side);
+		glm::vec3 color(0.5 + 0.5 * sin(i * 0.7), 0.5 + 0.5 * sin(i * 1.3 + 2), 0.5 + 0.5 * sin(i * 1.9 + 4));
+		if(i % 4 == 0) scene.lights.add(new SpotLight(position, glm::vec3(0, -1, 0), 30, 2, color, 8 * share));
+		else scene.lights.add(new PointLight(position, color, share));
+	}
+	scene.lights.add(new DirectionalLight(glm::vec3(0.3, -1, -0.5), glm::vec3(1, 0.95, 0.8), 0.2));
+}
+
+//---Scenes by name ------------------------------------------------------------------
+//   For the tools that pick a scene on the command line
+//----------------------------------------------------------------------------------
+const std::vector<std::string>& sceneNames() {
+	static const std::vector<std::string> names = { "demo", "grid_1k", "grid_100k", "grid_1m", "cloud_1k",
+													"cloud_100k", "cloud_1m", "mirror_corridor", "glass_spheres", "mesh_100k",
+													"mesh_1m", "many_lights", "many_lights_4k", "demo_area" };
+	return names;
+}
+
+bool buildScene(const std::string& name, Scene& scene, TextureCache& textureCache) {
+	srand(1);	//Random sphere clouds are the same every run
+	if(name == "demo") buildDemoScene(scene, textureCache);
+	else if(name == "grid_1k") drawCircles(scene, 1000, false);
+	else if(name == "grid_100k") drawCircles(scene, 100000, false);
+	else if(name == "grid_1m") drawCircles(scene, 1000000, false);
+	else if(name == "cloud_1k") drawCircles(scene, 1000, true);
+	else if(name == "cloud_100k") drawCircles(scene, 100000, true);
+	else if(name == "cloud_1m") drawCircles(scene, 1000000, true);
+	else if(name == "mirror_corridor") buildMirrorCorridor(scene);
+	else if(name == "glass_spheres") buildGlassSpheres(scene);
+	else if(name == "mesh_100k") buildMesh(scene, 100000);
+	else if(name == "mesh_1m") buildMesh(scene, 1000000);
+	else if(name == "many_lights") buildManyLights(scene, 256);
+	else if(name == "many_lights_4k") buildManyLights(scene, 4096);
+	else if(name == "demo_area") buildDemoScene(scene, textureCache, true);
+	else {
+		std::cout << "Error :: Unknown scene '" << name << "'" << std::endl;
+		return false;
+	}
+
+	// Scenes without lights of their own get one over the camera
+	if(scene.lights.size() == 0) scene.lights.add(new PointLight(glm::vec3(10, 30, -3)));
+	return true;
+}
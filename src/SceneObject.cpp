@@ -8,114 +8,47 @@
 -----------------------------------------------------------------*/
 
 #include "SceneObject.h"
-
-glm::vec3 SceneObject::getColor(glm::vec3 hit) {
-	return color_;
-}
-
-LightingResult SceneObject::lighting(glm::vec3 lightPos, glm::vec3 viewVec, glm::vec3 hit) {
-	float ambient = 0.2;
-	float specular = 0;
-	glm::vec3 normalVec = normal(hit);
-	glm::vec3 lightVec = lightPos - hit;
-	lightVec = glm::normalize(lightVec);
-	float lDotn = glm::dot(lightVec, normalVec);
-	if (spec_) {
-		glm::vec3 reflVec = glm::reflect(-lightVec, normalVec);
-		float rDotv = glm::dot(reflVec, viewVec);
-		if (rDotv > 0) specular = pow(rDotv, shin_);
+#include <cmath>
+#include <algorithm>
+
+/**
+* The two world axes closest to the surface at hit, so checkers on curved
+* objects are laid out like three checkered planes seen from each side.
+*/
+void SceneObject::patternAxes(const glm::vec3& hit, glm::vec3& axis1, glm::vec3& axis2) {
+	glm::vec3 n = glm::abs(normal(hit));
+	if(n.x >= n.y && n.x >= n.z) {
+		axis1 = glm::vec3(0, 1, 0);
+		axis2 = glm::vec3(0, 0, 1);
+	} else if(n.y >= n.z) {
+		axis1 = glm::vec3(1, 0, 0);
+		axis2 = glm::vec3(0, 0, 1);
+	} else {
+		axis1 = glm::vec3(1, 0, 0);
+		axis2 = glm::vec3(0, 1, 0);
 	}
-	glm::vec3 color = this->getColor(hit);
-
-	glm::vec3 ambientColor = ambient * color;
-	glm::vec3 diffuseColor = lDotn * color;
-	glm::vec3 specularColor = specular * glm::vec3(1);
-
-	return LightingResult{ ambientColor, diffuseColor, specularColor };
-}
-
-float SceneObject::getReflectionCoeff() {
-	return reflc_;
-}
-
-float SceneObject::getRefractionCoeff() {
-	return refrc_;
-}
-
-float SceneObject::getTransparencyCoeff() {
-	return tranc_;
-}
-
-float SceneObject::getRefractiveIndex() {
-	return refri_;
-}
-
-float SceneObject::getShininess() {
-	return shin_;
-}
-
-bool SceneObject::isReflective() {
-	return refl_;
-}
-
-bool SceneObject::isRefractive() {
-	return refr_;
-}
-
-
-bool SceneObject::isSpecular() {
-	return spec_;
-}
-
-
-bool SceneObject::isTransparent() {
-	return tran_;
-}
-
-void SceneObject::setColor(glm::vec3 col) {
-	color_ = col;
-}
-
-void SceneObject::setReflectivity(bool flag) {
-	refl_ = flag;
-}
-
-void SceneObject::setReflectivity(bool flag, float refl_coeff) {
-	refl_ = flag;
-	reflc_ = refl_coeff;
-}
-
-void SceneObject::setRefractivity(bool flag) {
-	refr_ = flag;
-}
-
-void SceneObject::setRefractivity(bool flag, float refr_coeff, float refr_index) {
-	refr_ = flag;
-	refrc_ = refr_coeff;
-	refri_ = refr_index;
-}
-
-void SceneObject::setShininess(float shininess) {
-	shin_ = shininess;
-}
-
-void SceneObject::setSpecularity(bool flag) {
-	spec_ = flag;
-}
-
-void SceneObject::setTransparency(bool flag) {
-	tran_ = flag;
 }
 
-void SceneObject::setTransparency(bool flag, float tran_coeff) {
-	tran_ = flag;
-	tranc_ = tran_coeff;
+/**
+* Spherical mapping about the centre of the bounding box, for objects
+* without coordinates of their own.
+*/
+bool SceneObject::textureCoords(const glm::vec3& hit, const glm::vec2&, const RayDifferential& footprint, glm::vec2& st, float& filterWidth) {
+	glm::vec3 d = hit - aabb_.getCenter();
+	float radius = glm::length(aabb_.getMax() - aabb_.getCenter());
+	float len = glm::length(d);
+	if(len <= 0) return false;
+	float phi = atan2(d.z, d.x);
+	if(phi < 0.0) phi += 2 * M_PI;
+	st = glm::vec2(phi / (2 * M_PI), 1 - acos(std::max(-1.0f, std::min(1.0f, d.y / len))) / M_PI);
+	filterWidth = footprint.width() / (M_PI * radius);
+	return true;
 }
 
 AABB SceneObject::getBBox() {
 	return aabb_;
 }
 
-float SceneObject::intersectAABB(glm::vec3 p0, glm::vec3 dir) {
+float SceneObject::intersectAABB(const glm::vec3& p0, const glm::vec3& dir) {
 	return aabb_.intersect(p0, dir);
 }
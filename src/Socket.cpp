@@ -0,0 +1,161 @@
+#include "Socket.h"
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+using namespace std;
+
+#ifdef MSG_NOSIGNAL
+const int SEND_FLAGS = MSG_NOSIGNAL;    // a closed peer is an error, not SIGPIPE
+#else
+const int SEND_FLAGS = 0;
+#endif
+
+void putU32(string& buf, uint32_t v) {
+    v = htonl(v);
+    buf.append((const char*)&v, 4);
+}
+
+uint32_t getU32(const string& buf, size_t offset) {
+    uint32_t v;
+    memcpy(&v, buf.data() + offset, 4);
+    return ntohl(v);
+}
+
+void putFloat(string& buf, float f) {
+    uint32_t bits;
+    memcpy(&bits, &f, 4);
+    putU32(buf, bits);
+}
+
+float getFloat(const string& buf, size_t offset) {
+    uint32_t bits = getU32(buf, offset);
+    float f;
+    memcpy(&f, &bits, 4);
+    return f;
+}
+
+static bool recvAll(int fd, char* data, size_t size) {
+    while (size > 0) {
+        ssize_t n = recv(fd, data, size, 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        data += n;
+        size -= n;
+    }
+    return true;
+}
+
+void putHeader(string& buf, uint32_t type, uint32_t size) {
+    putU32(buf, type);
+    putU32(buf, size);
+}
+
+// The header and payload go out in one gather write, so the payload is never copied
+bool sendMessage(int fd, uint32_t type, const string& payload) {
+    string header;
+    putHeader(header, type, payload.size());
+    iovec parts[2] = { { &header[0], header.size() }, { (void*)payload.data(), payload.size() } };
+    msghdr msg = {};
+    msg.msg_iov = parts;
+    msg.msg_iovlen = 2;
+    while (msg.msg_iovlen > 0) {
+        ssize_t n = sendmsg(fd, &msg, SEND_FLAGS);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 || (n == 0 && msg.msg_iov->iov_len > 0)) return false;
+        while (msg.msg_iovlen > 0 && (size_t)n >= msg.msg_iov->iov_len) {
+            n -= msg.msg_iov->iov_len;
+            msg.msg_iov++;
+            msg.msg_iovlen--;
+        }
+        if (msg.msg_iovlen > 0) {
+            msg.msg_iov->iov_base = (char*)msg.msg_iov->iov_base + n;
+            msg.msg_iov->iov_len -= n;
+        }
+    }
+    return true;
+}
+
+bool sendPending(int fd, const string& buf, size_t& sent) {
+    while (sent < buf.size()) {
+        ssize_t n = send(fd, buf.data() + sent, buf.size() - sent, SEND_FLAGS | MSG_DONTWAIT);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return true;
+        if (n <= 0) return false;
+        sent += n;
+    }
+    return true;
+}
+
+bool recvMessage(int fd, uint32_t& type, string& payload, uint32_t maxPayload) {
+    string header(8, '\0');
+    if (!recvAll(fd, &header[0], 8)) return false;
+    type = getU32(header, 0);
+    uint32_t size = getU32(header, 4);
+    if (size > maxPayload) return false;
+    payload.resize(size);
+    return size == 0 || recvAll(fd, &payload[0], size);
+}
+
+int openSocket(const string& address, bool listening, string& unixPath) {
+    if (address.compare(0, 5, "unix:") == 0) {
+        sockaddr_un addr = {};
+        addr.sun_family = AF_UNIX;
+        unixPath = address.substr(5);
+        if (unixPath.empty() || unixPath.size() >= sizeof(addr.sun_path)) {
+            cout << "Error :: Invalid Unix socket path '" << unixPath << "'" << endl;
+            return -1;
+        }
+        strcpy(addr.sun_path, unixPath.c_str());
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0) return -1;
+        if (listening) unlink(unixPath.c_str());
+        int ok = listening ? ::bind(fd, (sockaddr*)&addr, sizeof(addr)) : connect(fd, (sockaddr*)&addr, sizeof(addr));
+        if (ok == 0 && (!listening || ::listen(fd, 16) == 0)) return fd;
+        close(fd);
+        return -1;
+    }
+
+    size_t colon = address.rfind(':');
+    if (colon == string::npos) {
+        cout << "Error :: Expected host:port or unix:path, got '" << address << "'" << endl;
+        return -1;
+    }
+    string host = address.substr(0, colon);
+    string port = address.substr(colon + 1);
+    addrinfo hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = listening ? AI_PASSIVE : 0;
+    addrinfo *results = nullptr;
+    int err = getaddrinfo(host.empty() ? nullptr : host.c_str(), port.c_str(), &hints, &results);
+    if (err != 0) {
+        cout << "Error :: Unable to resolve " << address << ": " << gai_strerror(err) << endl;
+        return -1;
+    }
+
+    int fd = -1;
+    for (addrinfo *ai = results; ai != nullptr; ai = ai->ai_next) {
+        fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (fd < 0) continue;
+        int one = 1;
+        if (listening) {
+            setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+            if (::bind(fd, ai->ai_addr, ai->ai_addrlen) == 0 && ::listen(fd, 16) == 0) break;
+        } else if (connect(fd, ai->ai_addr, ai->ai_addrlen) == 0) {
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));    // requests are a few bytes
+            break;
+        }
+        close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(results);
+    return fd;
+}
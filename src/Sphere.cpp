@@ -8,25 +8,28 @@
 
 #include "Sphere.h"
 #include <math.h>
+#include <algorithm>
 
 /**
 * Sphere's intersection method.  The input is a ray. 
+* dir is a unit vector, so the roots are -b +/- sqrt(b*b - c). The one with
+* the same sign as -b is found without cancellation and the other from their
+* product c, so far spheres and grazing rays keep their precision.
+* SphereBatch::intersect() is the same test eight spheres at a time.
 */
-float Sphere::intersect(glm::vec3 p0, glm::vec3 dir) {
-    // if (aabb_.intersect(p0, dir) == -1.0) return -1.0;  // No intersection if ray does not intersect AABB
-
+float Sphere::intersect(const glm::vec3& p0, const glm::vec3& dir) {
     glm::vec3 vdif = p0 - center;   //Vector s (see Slide 28)
     float b = glm::dot(dir, vdif);
-    float len = glm::length(vdif);
-    float c = len*len - radius*radius;
+    float c = glm::dot(vdif, vdif) - radiusSq;
     float delta = b*b - c;
    
-	if(delta < 0.001) return -1.0;    //includes zero and negative values
+	if(delta < 0) return -1.0;    //Misses; a tangent ray (delta = 0) touches the sphere once
 
-    float t1 = -b - sqrt(delta);
-    float t2 = -b + sqrt(delta);
+    float q = -b - copysignf(sqrtf(delta), b);
+    float t1 = std::min(q, c / q);
+    float t2 = std::max(q, c / q);
 
-	if (t1 < 0)
+	if (t1 <= 0)
 	{
 		return (t2 > 0) ? t2 : -1;
 	}
@@ -37,7 +40,7 @@ float Sphere::intersect(glm::vec3 p0, glm::vec3 dir) {
 * Returns the unit normal vector at a given point.
 * Assumption: The input point p lies on the sphere.
 */
-glm::vec3 Sphere::normal(glm::vec3 p) {
+glm::vec3 Sphere::normal(const glm::vec3& p) {
     glm::vec3 n = p - center;
     n = glm::normalize(n);
     return n;
@@ -48,25 +51,13 @@ void Sphere::calculateAABB() {
     aabb_ = AABB(center - glm::vec3(radius), center + glm::vec3(radius));
 }
 
-void Sphere::setTextured(bool flag) {
-    tex_ = flag;
-}
-
-void Sphere::setTexture(TextureBMP file) {
-    tex_ = true;
-    texture_ = file;
-}
-
-glm::vec3 Sphere::getColor(glm::vec3 hit){
-    glm::vec3 color = color_;
-    if(tex_){
-        float theta = acos((hit.y - center.y) / radius);
-        float phi = atan2(hit.z - center.z, hit.x - center.x);
-        if(phi < 0.0) phi += 2 * M_PI;
-        float u = phi / (2 * M_PI);
-        float v = 1 - theta / M_PI;
-        color = texture_.getColorAt(u, v);
-    }
-
-    return color;
+//Longitude and latitude, the image wrapping once around the y axis
+bool Sphere::textureCoords(const glm::vec3& hit, const glm::vec2&, const RayDifferential& footprint, glm::vec2& st, float& filterWidth) {
+    float theta = acos((hit.y - center.y) / radius);
+    float phi = atan2(hit.z - center.z, hit.x - center.x);
+    if(phi < 0.0) phi += 2 * M_PI;
+    st = glm::vec2(phi / (2 * M_PI), 1 - theta / M_PI);
+    // v spans half the circumference, so scale the footprint by it
+    filterWidth = footprint.width() / (M_PI * radius);
+    return true;
 }
\ No newline at end of file
@@ -0,0 +1,50 @@
+#include "SphereBatch.h"
+#include <cmath>
+#include <limits>
+#include "Sphere.h"
+using namespace std;
+
+void SphereBatch::add(const Sphere& sphere, int id) {
+    primID[count] = id;
+    set(count++, sphere);
+}
+
+void SphereBatch::set(int lane, const Sphere& sphere) {
+    glm::vec3 center = sphere.getCenter();
+    centerX[lane] = center.x;
+    centerY[lane] = center.y;
+    centerZ[lane] = center.z;
+    radiusSq[lane] = sphere.getRadiusSq();
+}
+
+int SphereBatch::intersect(const glm::vec3& p0, const glm::vec3& dir, float tMin, float tMax, float& t) const {
+    const float miss = numeric_limits<float>::infinity();
+    float laneT[SPHERE_BATCH_WIDTH];
+
+    // every lane runs to the end without branching so the loop vectorises;
+    // the arithmetic is Sphere::intersect()'s, in the same order
+    for (int i = 0; i < SPHERE_BATCH_WIDTH; i++) {
+        float sx = p0.x - centerX[i];
+        float sy = p0.y - centerY[i];
+        float sz = p0.z - centerZ[i];
+        float b = dir.x * sx + dir.y * sy + dir.z * sz;
+        float c = (sx * sx + sy * sy + sz * sz) - radiusSq[i];
+        float delta = b * b - c;
+        float q = -b - copysignf(sqrtf(max(delta, 0.0f)), b);
+        float t1 = min(q, c / q);
+        float t2 = max(q, c / q);
+        float ti = t1 > tMin ? t1 : t2;
+        bool hit = i < count && delta >= 0 && ti > tMin && ti < tMax;
+        laneT[i] = hit ? ti : miss;
+    }
+
+    int closest = -1;
+    for (int i = 0; i < SPHERE_BATCH_WIDTH; i++) {
+        if (laneT[i] < tMax) {
+            tMax = laneT[i];
+            closest = i;
+        }
+    }
+    if (closest >= 0) t = tMax;
+    return closest;
+}
@@ -8,15 +8,32 @@
 //=====================================================================
 
 #include "TextureBMP.h"
+#include "MappedFile.h"
+#include <cmath>
+#include <cstring>
+
+// Lookup table from an 8 bit channel to a normalized float
+static const struct ByteToFloat {
+    float value[256];
+    ByteToFloat() { for (int i = 0; i < 256; i++) value[i] = i / 255.0f; }
+} byteToFloat;
+
+static inline uint32_t packRGBA(unsigned int r, unsigned int g, unsigned int b, unsigned int a) {
+    return r | (g << 8) | (b << 16) | (a << 24);
+}
+
+// Wraps a texel coordinate into [0, size) so filtering repeats across the seam
+static inline int wrap(int i, int size) {
+    i %= size;
+    return (i < 0) ? i + size : i;
+}
 
 TextureBMP::TextureBMP(const char* filename)
 {
-	imageWid = 0;
-	imageHgt = 0;
     if (loadBMPImage(filename)) {
 		cout << "Image " << filename << "  loaded successfully." << endl;
-		//cout << "Width = " << imageWid << "  Height = " << imageHgt <<
-		//	"  Channels = " << imageChnls << endl;
+		//cout << "Width = " << getWidth() << "  Height = " << getHeight() <<
+		//	"  Levels = " << getNumLevels() << endl;
     } else {
         cerr << "Could not load image.";
     }
@@ -24,66 +41,183 @@ TextureBMP::TextureBMP(const char* filename)
 
 /**
  * Return color at texture coord (u, v) where u and v are in [0,1]
+ * using the full resolution image
+ */
+glm::vec3 TextureBMP::getColorAt(float u, float v) const
+{
+    return getColorAt(u, v, 0.0f);
+}
+
+/**
+ * Return color at texture coord (u, v) where u and v are in [0,1].
+ * footprint is the width of the area covered by the sample in texture
+ * coordinates, and selects the mip level(s) to filter from.
+ */
+glm::vec3 TextureBMP::getColorAt(float u, float v, float footprint) const
+{
+	if(mips.empty()) return glm::vec3(0);
+	if(u < 0 || u > 1 || v < 0 || v > 1) return glm::vec3(0);
+
+    if (filter == TEX_FILTER_NEAREST) return sampleNearest(mips[0], u, v);
+
+    // level of detail is the log2 of the number of base texels under the footprint
+    float lod = 0.0f;
+    if (filter == TEX_FILTER_TRILINEAR && footprint > 0.0f) {
+        lod = std::log2(footprint * std::max(mips[0].wid, mips[0].hgt));
+        lod = glm::clamp(lod, 0.0f, (float)(mips.size() - 1));
+    }
+
+    int level = (int)lod;
+    float frac = lod - level;
+    glm::vec3 color = sampleBilinear(mips[level], u, v);
+    if (frac > 0.0f && level + 1 < (int)mips.size()) {
+        color = glm::mix(color, sampleBilinear(mips[level + 1], u, v), frac);
+    }
+    return color;
+}
+
+glm::vec3 TextureBMP::fetch(const MipLevel& level, int i, int j) const
+{
+    int tile = (j / TEX_TILE_SIZE) * level.tilesX + (i / TEX_TILE_SIZE);
+    int offset = (j % TEX_TILE_SIZE) * TEX_TILE_SIZE + (i % TEX_TILE_SIZE);
+    uint32_t texel = level.texels[tile * TEX_TILE_SIZE * TEX_TILE_SIZE + offset];
+
+    return glm::vec3(byteToFloat.value[texel & 0xff],
+                     byteToFloat.value[(texel >> 8) & 0xff],
+                     byteToFloat.value[(texel >> 16) & 0xff]);
+}
+
+glm::vec3 TextureBMP::sampleNearest(const MipLevel& level, float u, float v) const
+{
+    int i = std::min((int)(u * level.wid), level.wid - 1);
+    int j = std::min((int)(v * level.hgt), level.hgt - 1);
+    return fetch(level, i, j);
+}
+
+glm::vec3 TextureBMP::sampleBilinear(const MipLevel& level, float u, float v) const
+{
+    // texel centres are at half integer coordinates
+    float x = u * level.wid - 0.5f;
+    float y = v * level.hgt - 0.5f;
+    float fx = std::floor(x);
+    float fy = std::floor(y);
+    float tx = x - fx;
+    float ty = y - fy;
+
+    int i0 = wrap((int)fx, level.wid), i1 = wrap((int)fx + 1, level.wid);
+    int j0 = wrap((int)fy, level.hgt), j1 = wrap((int)fy + 1, level.hgt);
+
+    glm::vec3 bottom = glm::mix(fetch(level, i0, j0), fetch(level, i1, j0), tx);
+    glm::vec3 top = glm::mix(fetch(level, i0, j1), fetch(level, i1, j1), tx);
+    return glm::mix(bottom, top, ty);
+}
+
+/**
+ * Copies a row-major image into the tiled layout of the given level.
+ * Tiles on the right and top edges are padded with the edge texels.
  */
-glm::vec3 TextureBMP::getColorAt(float u, float v)
+void TextureBMP::setLevel(MipLevel& level, int wid, int hgt, const std::vector<uint32_t>& linear)
 {
-	if(imageWid == 0 || imageHgt == 0) return glm::vec3(0);
-    int i = (int) (u * imageWid);  //pixel coordinates
-    int j = (int) (v * imageHgt);
-	if(i < 0 || i > imageWid-1 || j < 0 || j > imageHgt-1) return glm::vec3(0);
-    int index = ((j * imageWid) + i) * imageChnls;
-
-    int r = imageData[index];
-    int g = imageData[index + 1];
-    int b = imageData[index + 2];
-
-	if(r < 0) r += 255;   //Unsigned byte values
-	if(g < 0) g += 255;
-	if(b < 0) b += 255;
- 
-    float rn = (float)r / 255.0;  //Normalized colour values
-    float gn = (float)g / 255.0;
-    float bn = (float)b / 255.0;
-    return glm::vec3(rn, gn, bn);
+    level.wid = wid;
+    level.hgt = hgt;
+    level.tilesX = (wid + TEX_TILE_SIZE - 1) / TEX_TILE_SIZE;
+    int tilesY = (hgt + TEX_TILE_SIZE - 1) / TEX_TILE_SIZE;
+    level.texels.resize(level.tilesX * tilesY * TEX_TILE_SIZE * TEX_TILE_SIZE);
+
+    for (int j = 0; j < tilesY * TEX_TILE_SIZE; j++) {
+        for (int i = 0; i < level.tilesX * TEX_TILE_SIZE; i++) {
+            int tile = (j / TEX_TILE_SIZE) * level.tilesX + (i / TEX_TILE_SIZE);
+            int offset = (j % TEX_TILE_SIZE) * TEX_TILE_SIZE + (i % TEX_TILE_SIZE);
+            int src = std::min(j, hgt - 1) * wid + std::min(i, wid - 1);
+            level.texels[tile * TEX_TILE_SIZE * TEX_TILE_SIZE + offset] = linear[src];
+        }
+    }
+}
+
+/**
+ * Builds every level of the mip chain down to 1x1 by averaging 2x2 blocks
+ * of the level above. Odd sized levels clamp the block to the edge.
+ */
+void TextureBMP::buildMipChain(std::vector<uint32_t> linear)
+{
+    int wid = mips[0].wid;
+    int hgt = mips[0].hgt;
+
+    while (wid > 1 || hgt > 1) {
+        int nextWid = std::max(1, wid / 2);
+        int nextHgt = std::max(1, hgt / 2);
+        std::vector<uint32_t> next(nextWid * nextHgt);
+
+        for (int j = 0; j < nextHgt; j++) {
+            for (int i = 0; i < nextWid; i++) {
+                int x0 = std::min(2 * i, wid - 1), x1 = std::min(2 * i + 1, wid - 1);
+                int y0 = std::min(2 * j, hgt - 1), y1 = std::min(2 * j + 1, hgt - 1);
+                uint32_t t[4] = { linear[y0 * wid + x0], linear[y0 * wid + x1],
+                                  linear[y1 * wid + x0], linear[y1 * wid + x1] };
+                unsigned int sum[4] = { 0, 0, 0, 0 };
+                for (int k = 0; k < 4; k++) {
+                    for (int c = 0; c < 4; c++) sum[c] += (t[k] >> (8 * c)) & 0xff;
+                }
+                next[j * nextWid + i] = packRGBA((sum[0] + 2) / 4, (sum[1] + 2) / 4, (sum[2] + 2) / 4, (sum[3] + 2) / 4);
+            }
+        }
+
+        mips.emplace_back();
+        setLevel(mips.back(), nextWid, nextHgt, next);
+        linear.swap(next);
+        wid = nextWid;
+        hgt = nextHgt;
+    }
 }
 
 bool TextureBMP::loadBMPImage(const char* filename)
 {
-    char header1[18], header2[24];
-    short int planes, bpp;
-    int wid, hgt;
-    int nbytes, size, indx, temp;
-    ifstream file( filename, ios::in | ios::binary);
-    if(!file)
+    MappedFile file(filename);
+    if(!file.isOpen())
     {
         cout << "*** Error opening image file: " << filename << endl;
         return false;
     }
-    file.read (header1, 18);        //Initial part of header
-    file.read ((char*)&wid, 4);     //Width
-    file.read ((char*)&hgt, 4);     //Height
-    file.read ((char*)&planes, 2);  //Planes
-    file.read ((char*)&bpp, 2);     //Bits per pixel
-    file.read (header2, 24);        //Remaining part of header
-
-    nbytes = bpp / 8;           //No. of bytes per pixels
-    size = wid * hgt * nbytes;  //Total number of bytes to be read
-    imageData = new char[size];
-    file.read(imageData, size);
-    if(nbytes > 2)   //swap R and B
+    const unsigned char* data = file.getData();
+    size_t size = file.getSize();
+
+    // header fields are read straight out of the mapped file
+    int dataOffset, wid, hgt;
+    short int bpp;
+    if(size < 54 || data[0] != 'B' || data[1] != 'M')
+    {
+        cout << "*** Unsupported image file: " << filename << endl;
+        return false;
+    }
+    memcpy(&dataOffset, data + 10, 4); //Offset of the pixel data
+    memcpy(&wid, data + 18, 4);        //Width
+    memcpy(&hgt, data + 22, 4);        //Height
+    memcpy(&bpp, data + 28, 2);        //Bits per pixel
+
+    int nbytes = bpp / 8;           //No. of bytes per pixels
+    // rows are padded to a multiple of 4 bytes
+    size_t rowSize = ((size_t)wid * nbytes + 3) & ~(size_t)3;
+    if(wid <= 0 || hgt <= 0 || nbytes < 3 || dataOffset < 54 || (size_t)dataOffset + rowSize * hgt > size)
+    {
+        cout << "*** Unsupported image file: " << filename << endl;
+        return false;
+    }
+
+    std::vector<uint32_t> linear((size_t)wid * hgt);
+    for(int j = 0; j < hgt; j++)
     {
-        for(int i = 0; i < wid*hgt;  i++)
+        const unsigned char* row = data + dataOffset + j * rowSize;
+        for(int i = 0; i < wid; i++)
         {
-            indx = i*nbytes;
-            temp = imageData[indx];
-            imageData[indx] = imageData[indx+2];
-            imageData[indx+2] = temp;
+            const unsigned char* px = row + i * nbytes;   //stored as BGR(A)
+            linear[j * wid + i] = packRGBA(px[2], px[1], px[0], 255);
         }
     }
 
-    imageWid = wid;
-    imageHgt = hgt;
-    imageChnls = nbytes;
+    mips.clear();
+    mips.emplace_back();
+    setLevel(mips[0], wid, hgt, linear);
+    buildMipChain(std::move(linear));
 
     return true;
 }
@@ -0,0 +1,63 @@
+#include "TextureCache.h"
+#include <thread>
+
+/*
+ * Returns a handle to the texture at path, decoding it on the first request.
+ * Concurrent requests for a file that is still loading wait for that load
+ * instead of starting their own.
+ */
+TextureHandle TextureCache::load(const std::string& path) {
+    std::promise<TextureHandle> promise;
+    std::shared_future<TextureHandle> future;
+    bool owner = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = textures.find(path);
+        if (it != textures.end()) {
+            future = it->second;
+        } else {
+            future = promise.get_future().share();
+            textures.emplace(path, future);
+            owner = true;
+        }
+    }
+
+    // decode outside the lock so other files can load in parallel
+    if (owner) {
+        promise.set_value(std::make_shared<const TextureBMP>(path.c_str()));
+    }
+    return future.get();
+}
+
+/*
+ * Loads all of the given textures in parallel, one thread per file.
+ */
+void TextureCache::preload(const std::vector<std::string>& paths) {
+    std::vector<std::thread> threads;
+    for (const std::string& path : paths) {
+        threads.emplace_back([this, path]() { load(path); });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+}
+
+/*
+ * Drops textures that are no longer referenced by any object.
+ */
+void TextureCache::purge() {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto it = textures.begin(); it != textures.end();) {
+        bool ready = it->second.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+        if (ready && it->second.get().use_count() == 1) {
+            it = textures.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+size_t TextureCache::size() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return textures.size();
+}
@@ -0,0 +1,194 @@
+/*==================================================================================
+* Offline renderer
+*   Renders a frame of one of the named scenes without opening a window and
+*   writes it as a BMP. The frame can be split across processes: a coordinator
+*   started with --listen hands out tiles to workers started with --connect,
+*   on this machine or others, and assembles the image they send back. With
+*   --frames it renders a range of frames of the scene's animation instead,
+*   and with --passes it refines one frame progressively, checkpointing as it
+*   goes so a stopped render can be resumed. With --serve it runs as a render
+*   service that keeps its scenes built between jobs, which --submit sends it.
+*
+*   RayTracerRender [--scene NAME] [--output FILE] [--listen ADDRESS] [render settings]
+*   RayTracerRender --frames FIRST:LAST [--fps F] [--output PATTERN] [--scene NAME] [render settings]
+*   RayTracerRender --passes N [--checkpoint FILE] [--checkpoint-interval S] [--resume] [--scene NAME] ...
+*   RayTracerRender --connect ADDRESS [--threads N]
+*   RayTracerRender --serve ADDRESS [--max-jobs N] [--max-queue N] [--preload NAMES] [--threads N]
+*   RayTracerRender --submit ADDRESS [--priority P] [--scene NAME] [--output FILE] [render settings]
+*===================================================================================
+*/
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <algorithm>
+#include "Scene.h"
+#include "Renderer.h"
+#include "TextureCache.h"
+#include "ImageWriter.h"
+#include "Distributed.h"
+#include "Animation.h"
+#include "Checkpoint.h"
+#include "RenderService.h"
+#include "Config.h"
+using namespace std;
+
+// FNV-1a over the bits of every colour, equal only for bit-identical images
+static uint64_t imageHash(const vector<glm::vec3>& pixels) {
+	uint64_t hash = 14695981039346656037ull;
+	const unsigned char *bytes = (const unsigned char*)pixels.data();
+	for (size_t i = 0; i < pixels.size() * sizeof(glm::vec3); i++) {
+		hash = (hash ^ bytes[i]) * 1099511628211ull;
+	}
+	return hash;
+}
+
+static void printUsage() {
+	cout << "Usage: RayTracerRender [options]" << endl;
+	cout << "  --scene NAME       scene to render (default demo)" << endl;
+	cout << "  --output FILE      BMP to write (default render.bmp)" << endl;
+	cout << "  --listen ADDRESS   coordinate workers on ADDRESS instead of rendering here" << endl;
+	cout << "  --connect ADDRESS  render tiles for the coordinator at ADDRESS until it exits" << endl;
+	cout << "  --frames A:B       render frames A to B of the scene's animation" << endl;
+	cout << "  --fps F            frames per second of the animation (default 24)" << endl;
+	cout << "                     --output is then a printf pattern (default frame_%04d.bmp)" << endl;
+	cout << "  --passes N         render progressively, N jittered samples per cell" << endl;
+	cout << "  --checkpoint FILE  save the progressive render to FILE as it goes" << endl;
+	cout << "  --checkpoint-interval S  seconds between checkpoints (default 60)" << endl;
+	cout << "  --resume           carry on from the --checkpoint FILE" << endl;
+	cout << "  --serve ADDRESS    run as a render service on ADDRESS until stopped" << endl;
+	cout << "  --max-jobs N       jobs the service traces at once (default 2)" << endl;
+	cout << "  --max-queue N      jobs the service queues before rejecting more (default 64)" << endl;
+	cout << "  --preload A,B,...  scenes the service builds as it starts" << endl;
+	cout << "  --submit ADDRESS   render on the service at ADDRESS instead of here" << endl;
+	cout << "  --priority P       priority of the submitted job, higher first (default 0)" << endl;
+	cout << "Addresses are host:port for TCP or unix:path for a Unix socket." << endl;
+	cout << "Scenes:";
+	for (const string& name : sceneNames()) cout << " " << name;
+	cout << endl;
+	cout << "Defaults to an 800 x 800 image with the BVH on." << endl;
+	printSettingsUsage();
+}
+
+int main(int argc, char *argv[]) {
+	RenderSettings settings;
+	settings.enableBVH = true;
+	string sceneName = "demo";
+	string outputPath = "render.bmp";
+	string listenAddress;
+	string connectAddress;
+	string frames;
+	AnimationSettings animation;
+	ProgressiveSettings progressive;
+	bool isProgressive = false;
+	string serveAddress;
+	string submitAddress;
+	ServiceSettings service;
+	int priority = 0;
+
+	vector<string> args;
+	if (!parseSettings(argc, argv, settings, args)) return 1;
+	for (size_t i = 0; i < args.size(); i++) {
+		const string& arg = args[i];
+		bool hasValue = i + 1 < args.size();
+		if (arg == "--scene" && hasValue) sceneName = args[++i];
+		else if (arg == "--output" && hasValue) outputPath = args[++i];
+		else if (arg == "--listen" && hasValue) listenAddress = args[++i];
+		else if (arg == "--connect" && hasValue) connectAddress = args[++i];
+		else if (arg == "--frames" && hasValue) frames = args[++i];
+		else if (arg == "--fps" && hasValue) animation.fps = atof(args[++i].c_str());
+		else if (arg == "--passes" && hasValue) {
+			progressive.passes = atoi(args[++i].c_str());
+			isProgressive = true;
+		}
+		else if (arg == "--checkpoint" && hasValue) progressive.checkpointPath = args[++i];
+		else if (arg == "--checkpoint-interval" && hasValue) progressive.checkpointInterval = atof(args[++i].c_str());
+		else if (arg == "--resume") progressive.resume = isProgressive = true;
+		else if (arg == "--serve" && hasValue) serveAddress = args[++i];
+		else if (arg == "--max-jobs" && hasValue) service.maxActiveJobs = atoi(args[++i].c_str());
+		else if (arg == "--max-queue" && hasValue) service.maxQueuedJobs = atoi(args[++i].c_str());
+		else if (arg == "--preload" && hasValue) {
+			string names = args[++i];
+			for (size_t start = 0; start <= names.size();) {
+				size_t comma = min(names.find(',', start), names.size());
+				if (comma > start) service.preload.push_back(names.substr(start, comma - start));
+				start = comma + 1;
+			}
+		}
+		else if (arg == "--submit" && hasValue) submitAddress = args[++i];
+		else if (arg == "--priority" && hasValue) priority = atoi(args[++i].c_str());
+		else {
+			printUsage();
+			return arg == "--help" ? 0 : 1;
+		}
+	}
+
+	if (!connectAddress.empty()) return runRenderWorker(connectAddress, settings.numThreads) ? 0 : 1;
+	if (!serveAddress.empty()) {
+		service.numThreads = settings.numThreads;
+		return runRenderService(serveAddress, service) ? 0 : 1;
+	}
+
+	const vector<string>& names = sceneNames();
+	if (find(names.begin(), names.end(), sceneName) == names.end()) {
+		cout << "Error :: Unknown scene '" << sceneName << "'" << endl;
+		return 1;
+	}
+
+	if (!frames.empty()) {
+		if (sscanf(frames.c_str(), "%d:%d", &animation.firstFrame, &animation.lastFrame) != 2 || !listenAddress.empty()) {
+			cout << "Error :: --frames takes FIRST:LAST and renders in this process" << endl;
+			return 1;
+		}
+		if (outputPath != "render.bmp") animation.outputPattern = outputPath;
+		return renderAnimation(sceneName, settings, animation) ? 0 : 1;
+	}
+
+	vector<glm::vec3> image;
+	if (isProgressive) {
+		if (progressive.passes < 1 || !listenAddress.empty() || (progressive.resume && progressive.checkpointPath.empty())) {
+			cout << "Error :: --passes must be positive and renders in this process, --resume needs --checkpoint" << endl;
+			return 1;
+		}
+		bool finished = renderProgressive(sceneName, settings, progressive, image);
+		if (image.empty()) return 1;
+		printf("Image hash %016llx\n", (unsigned long long)imageHash(image));
+		if (!writeBMP(outputPath, settings.width, settings.height, image)) return 1;
+		return finished ? 0 : 3;	//Stopped early, the image is a preview
+	}
+
+	auto start = chrono::steady_clock::now();
+	if (!listenAddress.empty()) {
+		// workers send back only colours, so the aux buffers the denoiser needs never reach this process
+		if (settings.denoise) {
+			cout << "Error :: --denoise renders in this process, not with --listen" << endl;
+			return 1;
+		}
+		RenderCoordinator coordinator;
+		if (!coordinator.listen(listenAddress)) return 1;
+		start = chrono::steady_clock::now();
+		if (!coordinator.render(sceneName, settings, image)) return 1;
+		coordinator.printWorkers();
+	} else if (!submitAddress.empty()) {
+		if (!submitRenderJob(submitAddress, sceneName, settings, priority, image)) return 1;
+	} else {
+		Scene scene;
+		TextureCache textureCache;
+		if (!buildScene(sceneName, scene, textureCache)) return 1;
+		scene.build();
+		Renderer renderer(&scene, settings);
+		renderer.render();
+		if (settings.printRayDebug) renderer.printRayDebug();
+		image = renderer.getFramebuffer();
+	}
+	double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+	printf("Rendered %s at %d x %d in %.1f ms, image hash %016llx\n", sceneName.c_str(), settings.width,
+		   settings.height, ms, (unsigned long long)imageHash(image));
+	return writeBMP(outputPath, settings.width, settings.height, image) ? 0 : 1;
+}